@@ -1,20 +1,153 @@
 #include "sources/mainwindow.h"
+#include "sources/plotcanvas.h"
+#include "sources/textview.h"
+#include "tracezones.h"
 #include <stdio.h>
+#include <math.h>
+#include <memory>
 
 #include <QApplication>
 #include <QLocale>
 #include <qstylefactory.h>
 #include <QFontDatabase>
+#include <QTimer>
 
 
 int main(int argc, char *argv[])
 {
+  // all plots share one context group, so text program and atlas are created once
+  QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
   QApplication a(argc, argv);
   a.setDesktopSettingsAware(false);
   a.setStyle(QStyleFactory::create("Fusion"));
 
+  // --zones <file> writes trace zones of the session as Chrome trace JSON
+  QStringList args = a.arguments();
+  int zones = args.indexOf("--zones");
+  if((zones > 0) && (zones + 1 < args.size()))
+    {
+#ifndef PLOT_TRACE_ZONES
+      fprintf(stderr, "Built without PLOT_TRACE_ZONES, trace will be empty\n");
+#endif
+      TraceZones::start();
+    }
+
   MainWindow w;
 //  w.setMinimumSize(1800,300);
+
+  // --record <file> writes session of the stream plot for plot_replay
+  int record = args.indexOf("--record");
+  if((record > 0) && (record + 1 < args.size()) && !w.recordTrace(args[record + 1]))
+    fprintf(stderr, "Can't record trace to %s\n", args[record + 1].toLocal8Bit().constData());
+
+  // --dataset <file> draws the upper plot from memory mapped file
+  int dataset = args.indexOf("--dataset");
+  if((dataset > 0) && (dataset + 1 < args.size()) && !w.plot->openDataset(args[dataset + 1]))
+    fprintf(stderr, "Can't open dataset %s\n", args[dataset + 1].toLocal8Bit().constData());
   w.show();
-  return a.exec();
+
+  // --canvas <n> shows n test plots in one surface, see PlotCanvas
+  std::unique_ptr<PlotCanvas> canvas;
+  int panels = args.indexOf("--canvas");
+  if((panels > 0) && (panels + 1 < args.size()) && (args[panels + 1].toInt() > 0))
+    {
+      int count = args[panels + 1].toInt();
+      canvas.reset(new PlotCanvas());
+      canvas->setColumns(static_cast<int>(ceil(sqrt(count))));
+      for(int i = 0; i < count; i++)
+        {
+          std::vector<double> xs(100000);
+          std::vector<double> ys(xs.size());
+          for(size_t j = 0; j < xs.size(); j++)
+            {
+              xs[j] = j * (1000.0 / xs.size());
+              ys[j] = 5 + 3 * sin(xs[j] * (i + 1) / 50) + (rand() % 1000) / 1000.0;
+            }
+          Proj view;
+          view.left = 0;
+          view.right = 1000;
+          view.bottom = 0;
+          view.top = 10;
+          PlotPanel *added = canvas->addPanel();
+          added->setData(xs, ys);
+          added->setView(view);
+        }
+      canvas->resize(1200, 800);
+      canvas->show();
+    }
+
+  // --heatmap <n> prints n x n matrix over the upper plot, random cells change every frame
+  std::vector<double> matrix;
+  QTimer cells;
+  int heatmap = args.indexOf("--heatmap");
+  if((heatmap > 0) && (heatmap + 1 < args.size()) && (args[heatmap + 1].toInt() > 0))
+    {
+      size_t size = args[heatmap + 1].toInt();
+      matrix.resize(size * size);
+      for(size_t i = 0; i < matrix.size(); i++)
+        matrix[i] = (rand() % 2000) / 1000.0 - 1;
+      Proj area;
+      area.left = 0;
+      area.right = 10000;
+      area.bottom = 0;
+      area.top = 10;
+      w.plot->setMatrix(matrix.data(), size, size, size, area);
+      QObject::connect(&cells, &QTimer::timeout, [&w, &matrix, size]()
+      {
+        for(int i = 0; i < 100; i++)
+          {
+            size_t cell = rand() % matrix.size();
+            matrix[cell] = (rand() % 2000) / 1000.0 - 1;
+            w.plot->updateMatrixCell(cell / size, cell % size);
+          }
+      });
+      cells.start(16);
+    }
+
+  // --log shows a text view fed with 100k lines/s, see TextView
+  std::unique_ptr<TextView> log;
+  QTimer feed;
+  size_t logged = 0;
+  if(args.indexOf("--log") > 0)
+    {
+      log.reset(new TextView());
+      log->resize(800, 600);
+      log->show();
+      QObject::connect(&feed, &QTimer::timeout, [&log, &logged]()
+      {
+        std::string text;
+        char line[128];
+        for(int i = 0; i < 1000; i++, logged++)
+          {
+            int length = snprintf(line, sizeof(line), "%zu event %d value %.4f\n",
+                                  logged, rand() % 100, (rand() % 100000) / 1000.0);
+            text.append(line, length);
+          }
+        log->appendText(text.data(), text.size());
+      });
+      feed.start(10);
+    }
+
+  // --text-budget <kB> caps text memory of each plot and atlases, usage is printed at exit
+  int budget = args.indexOf("--text-budget");
+  if((budget > 0) && (budget + 1 < args.size()) && (args[budget + 1].toInt() > 0))
+    {
+      size_t bytes = static_cast<size_t>(args[budget + 1].toInt()) * 1024;
+      w.plot->setTextBudget(bytes, bytes);
+      w.streamPlot->setTextBudget(bytes, bytes);
+      RenderText::setAtlasBudget(bytes);
+    }
+  int result = a.exec();
+
+  if(budget > 0)
+    {
+      TextMemory total = RenderText::totalMemoryUsage();
+      fprintf(stderr, "Text memory: %zu CPU bytes, %zu GPU bytes, %zu of them atlases\n",
+              total.cpuBytes, total.gpuBytes, total.atlasBytes);
+    }
+
+  if((zones > 0) && (zones + 1 < args.size()) &&
+     !TraceZones::exportJson(args[zones + 1].toLocal8Bit().constData()))
+    fprintf(stderr, "Can't write zones to %s\n", args[zones + 1].toLocal8Bit().constData());
+  return result;
 }
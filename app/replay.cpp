@@ -0,0 +1,277 @@
+#include "sources/mainwindow.h"
+#include "sources/frametrace.h"
+#include "tracezones.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <QApplication>
+#include <QElapsedTimer>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#define REPLAY_STATS 4            ///< Values reported and kept in baseline
+#define REPLAY_THRESHOLD 0.10     ///< Default allowed growth of frame times over baseline, 10 %
+#define REPLAY_FIRST_COUNT 2      ///< Stats from this one on are counts, any growth of them is a regression
+
+#define REPLAY_OK 0
+#define REPLAY_REGRESSION 1
+#define REPLAY_ERROR 2
+
+
+static const char *statNames[REPLAY_STATS] = { "p50_ms", "p99_ms", "upload_bytes", "draw_calls" };
+
+
+/*!
+ * \brief percentile
+ * \param times frame times, sorted ascending
+ * \param fraction 0.5 for median, 0.99 for p99
+ * \return frame time not exceeded by \param fraction of frames
+ */
+static double percentile(const std::vector<double> &times, double fraction)
+{
+  if(times.empty())
+    return 0;
+  size_t rank = static_cast<size_t>(fraction * times.size() + 0.999999);
+  rank = std::min(std::max(rank, static_cast<size_t>(1)), times.size());
+  return times[rank - 1];
+}
+
+
+/*!
+ * \brief readBaseline
+ * \param path text file of "name value" lines
+ * \param values filled in order of \var statNames
+ * \return false if file can't be read or misses a value
+ */
+static bool readBaseline(const char *path, double *values)
+{
+  FILE *file = fopen(path, "r");
+  if(file == nullptr)
+    return false;
+
+  bool found[REPLAY_STATS] = { false, false, false, false };
+  char name[64];
+  double value;
+  while(fscanf(file, "%63s %lf", name, &value) == 2)
+    {
+      for(int i = 0; i < REPLAY_STATS; i++)
+        if(strcmp(name, statNames[i]) == 0)
+          {
+            values[i] = value;
+            found[i] = true;
+          }
+    }
+  fclose(file);
+
+  for(int i = 0; i < REPLAY_STATS; i++)
+    if(!found[i])
+      return false;
+  return true;
+}
+
+
+/*!
+ * \brief writeBaseline
+ * \param path file to write
+ * \param values in order of \var statNames
+ * \return false if file can't be written
+ */
+static bool writeBaseline(const char *path, const double *values)
+{
+  FILE *file = fopen(path, "w");
+  if(file == nullptr)
+    return false;
+
+  for(int i = 0; i < REPLAY_STATS; i++)
+    fprintf(file, "%s %.6f\n", statNames[i], values[i]);
+  return fclose(file) == 0;
+}
+
+
+static void usage()
+{
+  fprintf(stderr,
+          "Usage: plot_replay <trace> [--baseline <file>] [--threshold <fraction>]\n"
+          "                           [--counts] [--write-baseline <file>] [--zones <file>]\n"
+          "Replay trace recorded with --record on offscreen surface and report\n"
+          "frame times, uploaded bytes and draw calls. Exits with %d if uploaded\n"
+          "bytes or draw calls grow over baseline, or a frame time grows by more\n"
+          "than threshold (default %.2f). --counts compares only uploaded bytes\n"
+          "and draw calls, frame times depend on machine. Trace zones of replay\n"
+          "are written to --zones file as Chrome trace JSON.\n",
+          REPLAY_REGRESSION, REPLAY_THRESHOLD);
+}
+
+
+/*!
+ * \brief main
+ *
+ * Headless replayer of traces from \class FrameTrace.
+ * Each recorded frame is painted synchronously and timed
+ * until GPU finishes, repaints requested in between, e.g.
+ * by text layout thread, are dropped, so one recorded frame
+ * is one timed paint. Layout thread is waited for before
+ * each paint, untimed, so every run draws the same frames
+ * and uploads and draw calls are exact. Runs on offscreen platform with
+ * software OpenGL (Mesa llvmpipe) unless QT_QPA_PLATFORM
+ * or LIBGL_ALWAYS_SOFTWARE are set, so numbers of one
+ * machine are comparable between runs.
+ */
+int main(int argc, char *argv[])
+{
+  const char *tracePath = nullptr;
+  const char *baselinePath = nullptr;
+  const char *writePath = nullptr;
+  const char *zonesPath = nullptr;
+  double threshold = REPLAY_THRESHOLD;
+  bool countsOnly = false;
+  for(int i = 1; i < argc; i++)
+    {
+      if((strcmp(argv[i], "--baseline") == 0) && (i + 1 < argc))
+        baselinePath = argv[++i];
+      else if((strcmp(argv[i], "--write-baseline") == 0) && (i + 1 < argc))
+        writePath = argv[++i];
+      else if((strcmp(argv[i], "--threshold") == 0) && (i + 1 < argc))
+        threshold = atof(argv[++i]);
+      else if(strcmp(argv[i], "--counts") == 0)
+        countsOnly = true;
+      else if((strcmp(argv[i], "--zones") == 0) && (i + 1 < argc))
+        zonesPath = argv[++i];
+      else if((argv[i][0] != '-') && (tracePath == nullptr))
+        tracePath = argv[i];
+      else
+        {
+          usage();
+          return REPLAY_ERROR;
+        }
+    }
+  if(tracePath == nullptr)
+    {
+      usage();
+      return REPLAY_ERROR;
+    }
+
+  if(!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  if(!qEnvironmentVariableIsSet("LIBGL_ALWAYS_SOFTWARE"))
+    qputenv("LIBGL_ALWAYS_SOFTWARE", "1");
+
+  QApplication::setAttribute(Qt::AA_ShareOpenGLContexts);
+  QApplication a(argc, argv);
+
+  FrameTrace trace;
+  if(!trace.replay(QString::fromLocal8Bit(tracePath)))
+    {
+      fprintf(stderr, "Can't read trace %s\n", tracePath);
+      return REPLAY_ERROR;
+    }
+
+  if(zonesPath != nullptr)
+    TraceZones::start();
+
+  Plot plot;
+  plot.resize(800, 300);
+  bool shown = false;
+
+  std::vector<double> times;
+  double uploads = 0;
+  double draws = 0;
+  TraceEvent event;
+  QElapsedTimer timer;
+  while(trace.next(event))
+    {
+      switch(event.type)
+        {
+        case TraceEvent::resize:
+          plot.resize(event.width, event.height);
+          break;
+        case TraceEvent::setData:
+          plot.setData(event.x, event.y);
+          break;
+        case TraceEvent::appendData:
+          plot.appendData(event.x, event.y);
+          break;
+        case TraceEvent::streamMode:
+          // renderers are created with the first frame
+          if(!shown)
+            plot.setStreamMode(event.capacity, event.value);
+          break;
+        case TraceEvent::samples:
+          plot.appendSamples(event.x.data(), event.y.data(), event.x.size());
+          break;
+        case TraceEvent::labelStyle:
+          plot.setLabelStyle(event.value, event.vertical != 0, event.style);
+          break;
+        case TraceEvent::frame:
+          if(!shown)
+            {
+              plot.show();
+              shown = true;
+              QCoreApplication::processEvents();
+            }
+          plot.waitTextLayout();
+          QCoreApplication::removePostedEvents(&plot, QEvent::MetaCall);
+          QCoreApplication::removePostedEvents(&plot, QEvent::UpdateRequest);
+
+          timer.start();
+          plot.repaint();
+          plot.makeCurrent();
+          QOpenGLContext::currentContext()->functions()->glFinish();
+          times.push_back(timer.nsecsElapsed() / 1e6);
+          plot.doneCurrent();
+
+          uploads += plot.uploadedBytes();
+          draws += plot.drawCalls();
+          break;
+        }
+    }
+
+  if((zonesPath != nullptr) && !TraceZones::exportJson(zonesPath))
+    fprintf(stderr, "Can't write zones to %s\n", zonesPath);
+
+  if(times.empty())
+    {
+      fprintf(stderr, "Trace %s has no frames\n", tracePath);
+      return REPLAY_ERROR;
+    }
+
+  std::sort(times.begin(), times.end());
+  double stats[REPLAY_STATS] = { percentile(times, 0.5), percentile(times, 0.99), uploads, draws };
+
+  printf("frames %zu\n", times.size());
+  for(int i = 0; i < REPLAY_STATS; i++)
+    printf("%s %.6f\n", statNames[i], stats[i]);
+
+  if((writePath != nullptr) && !writeBaseline(writePath, stats))
+    {
+      fprintf(stderr, "Can't write baseline %s\n", writePath);
+      return REPLAY_ERROR;
+    }
+
+  if(baselinePath == nullptr)
+    return REPLAY_OK;
+
+  double baseline[REPLAY_STATS];
+  if(!readBaseline(baselinePath, baseline))
+    {
+      fprintf(stderr, "Can't read baseline %s\n", baselinePath);
+      return REPLAY_ERROR;
+    }
+
+  int result = REPLAY_OK;
+  for(int i = 0; i < REPLAY_STATS; i++)
+    {
+      bool count = (i >= REPLAY_FIRST_COUNT);
+      if(countsOnly && !count)
+        continue;
+      if(stats[i] > (count ? baseline[i] : baseline[i] * (1 + threshold)))
+        {
+          fprintf(stderr, "Regression: %s %.6f, baseline %.6f\n", statNames[i], stats[i], baseline[i]);
+          result = REPLAY_REGRESSION;
+        }
+    }
+  return result;
+}
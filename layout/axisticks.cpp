@@ -0,0 +1,187 @@
+#include "axisticks.h"
+#include "tracezones.h"
+#include <math.h>
+
+
+AxisTicks::AxisTicks()
+{
+  rangeMin = 0;
+  rangeMax = 0;
+  current = -1;
+  rebuilt = false;
+}
+
+
+AxisTicks::~AxisTicks()
+{
+
+}
+
+
+/*!
+ * \brief AxisTicks::setRange
+ * \param min lowest value on axis
+ * \param max highest value on axis
+ *
+ * Precompute every level of detail for the range.
+ * Steps go as 1, 2, 5 * 10^n from the coarsest level,
+ * that holds at least two ticks, to the densest one,
+ * that holds no more than MAX_TICKS ticks.
+ * Labels are not formatted here, so it's cheap
+ * to call it on every range change.
+ */
+void AxisTicks::setRange(double min, double max)
+{
+  if((min == rangeMin) && (max == rangeMax) && !levels.empty())
+    return;
+
+  double laststep = step();
+
+  rangeMin = min;
+  rangeMax = max;
+  levels.clear();
+  current = -1;
+  rebuilt = true;
+
+  double span = max - min;
+  if(!(span > 0))
+    return;
+
+  const double mantissa[3] = { 1.0, 0.5, 0.2 };
+  double base = pow(10, ceil(log10(span)));
+  bool full = false;
+
+  while(!full)
+    {
+      for(int m = 0; m < 3; m++)
+        {
+          double step = base * mantissa[m];
+          double first = ceil(min / step - 1e-9);
+          double last = floor(max / step + 1e-9);
+          double count = last - first + 1;
+
+          if(count > MAX_TICKS)
+            {
+              full = true;
+              break;
+            }
+          if(count < 2)
+            continue;
+
+          Level level;
+          level.step = step;
+          level.labelWidth = -1;
+          level.values.reserve(static_cast<size_t>(count));
+          for(double i = first; i <= last; i++)
+            {
+              double value = i * step;
+              if(fabs(value) < step * 1e-9)       // don't print -0 or 1e-17 instead of zero
+                value = 0;
+              level.values.push_back(value);
+            }
+
+          // keep the step that was active before, so scrolling
+          // the range doesn't throw hysteresis away
+          if(fabs(step - laststep) < step * 1e-6)
+            current = levels.size();
+
+          levels.push_back(level);
+        }
+      base /= 10;
+    }
+}
+
+
+/*!
+ * \brief AxisTicks::selectLevel
+ * \param pixels length of axis in pixels
+ * \param horizontal true if labels are put side by side, false if stacked
+ * \param metrics used to measure labels
+ * \return true if values of active level were changed
+ *
+ * Pick the densest level which labels don't overlap.
+ * Going to a denser level needs TICK_HYSTERESIS times more
+ * room than it takes, so the level won't flicker while
+ * widget is resized around the edge of two levels.
+ */
+bool AxisTicks::selectLevel(int pixels, bool horizontal, const TextMetrics &metrics)
+{
+  TRACE_ZONE("select level");
+  int last = current;
+  bool changed = rebuilt;
+  rebuilt = false;
+
+  if(levels.empty() || (pixels <= 0))
+    {
+      current = -1;
+      return changed || (last != current);
+    }
+
+  double pixelsPerValue = pixels / (rangeMax - rangeMin);
+
+  // fit grows with step, so walk from the coarsest level
+  // and stop on the first that doesn't fit. That way only
+  // labels of checked levels are measured
+  int best = 0;
+  for(unsigned i = 0; i < levels.size(); i++)
+    {
+      double need = labelSpace(levels[i], horizontal, metrics);
+      if(!levelFits(levels[i], pixelsPerValue, need))
+        break;
+
+      if((static_cast<int>(i) > current) && (current >= 0) &&
+         !levelFits(levels[i], pixelsPerValue, need * TICK_HYSTERESIS))
+        break;
+
+      best = i;
+    }
+
+  current = best;
+  return changed || (last != current);
+}
+
+
+/*!
+ * \brief AxisTicks::labelSpace
+ * \param level to measure
+ * \param horizontal true if labels are put side by side
+ * \param metrics used to measure labels
+ * \return pixels one label takes on axis, including gap
+ */
+int AxisTicks::labelSpace(Level &level, bool horizontal, const TextMetrics &metrics)
+{
+  if(!horizontal)
+    return metrics.getCharacterHeight() * 2;
+
+  if(level.labelWidth < 0)
+    {
+      if(measured.size() > MAX_MEASURED)
+        measured.clear();
+
+      level.labelWidth = 0;
+      for(unsigned i = 0; i < level.values.size(); i++)
+        {
+          std::unordered_map<double, int>::iterator it = measured.find(level.values[i]);
+          if(it == measured.end())
+            it = measured.insert(std::make_pair(level.values[i], metrics.measureText(level.values[i]))).first;
+
+          if(it->second > level.labelWidth)
+            level.labelWidth = it->second;
+        }
+    }
+
+  return level.labelWidth + metrics.getCharacterWidth() * 2;
+}
+
+
+/*!
+ * \brief AxisTicks::levelFits
+ * \param level to check
+ * \param pixelsPerValue axis scale
+ * \param needed pixels one label takes
+ * \return true if labels of level won't overlap
+ */
+bool AxisTicks::levelFits(Level &level, double pixelsPerValue, double needed)
+{
+  return (level.step * pixelsPerValue >= needed);
+}
@@ -0,0 +1,66 @@
+#ifndef AXISTICKS_H
+#define AXISTICKS_H
+
+#include <vector>
+#include <unordered_map>
+
+#include "textmetrics.h"
+
+
+#define MAX_TICKS 64            ///< densest level never holds more ticks than that
+#define TICK_HYSTERESIS 1.25    ///< denser level is taken only with this much spare room
+#define MAX_MEASURED (MAX_TICKS * 8)  ///< label widths kept between range changes
+
+
+class AxisTicks
+{
+
+  struct Level
+  {
+    double step;                  ///< distance between neighbour ticks in axis values
+    std::vector<double> values;   ///< tick values, ascending
+    int labelWidth;               ///< widest label of level in pixels, -1 until measured
+  };
+
+public:
+  explicit AxisTicks();
+  ~AxisTicks();
+
+  void setRange(double min, double max);
+  bool selectLevel(int pixels, bool horizontal, const TextMetrics &metrics);
+
+  inline const std::vector<double> &values();
+  inline double step();
+
+private:
+  int labelSpace(Level &level, bool horizontal, const TextMetrics &metrics);
+  bool levelFits(Level &level, double pixelsPerValue, double needed);
+
+  std::vector<Level> levels;    ///< precomputed levels, from the coarsest to the densest
+  std::unordered_map<double, int> measured;   ///< label widths by value, so scrolled labels aren't sliced again
+  std::vector<double> empty;
+
+  double rangeMin;
+  double rangeMax;
+  int current;                  ///< active level, -1 if none selected
+  bool rebuilt;                 ///< levels were recomputed since last selection
+};
+
+
+inline const std::vector<double> &AxisTicks::values()
+{
+  if(current < 0)
+    return empty;
+  return levels[current].values;
+}
+
+
+inline double AxisTicks::step()
+{
+  if(current < 0)
+    return 0;
+  return levels[current].step;
+}
+
+
+#endif // AXISTICKS_H
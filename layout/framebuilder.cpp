@@ -0,0 +1,203 @@
+#include "framebuilder.h"
+#include "tracezones.h"
+
+
+FrameBuilder::FrameBuilder()
+{
+  running = false;
+  submitted = 0;
+  built = 0;
+}
+
+
+FrameBuilder::~FrameBuilder()
+{
+  stop();
+}
+
+
+/*!
+ * \brief FrameBuilder::start
+ * \param chars glyph metrics and atlas positions
+ * \param width width of glyph cell in pixels
+ * \param height height of glyph cell in pixels
+ * \param colFactor width of one glyph in texture atlas
+ * \param ready called on worker thread when a new frame
+ *    can be acquired, e.g. to schedule repaint
+ *
+ * Start worker thread that lays out labels
+ * and packs vertices of the newest request.
+ */
+void FrameBuilder::start(const std::unordered_map<char, Character> &chars, int width, int height,
+                         double colFactor, std::function<void()> ready)
+{
+  stop();
+
+  layout.setGlyphs(chars, width, height, colFactor);
+  appliedY.clear();
+  appliedX.clear();
+  appliedYStyles.clear();
+  appliedXStyles.clear();
+  frameReady = ready;
+  submitted = 0;
+  built = 0;
+
+  running = true;
+  worker = std::thread(&FrameBuilder::run, this);
+}
+
+
+/*!
+ * \brief FrameBuilder::stop
+ *
+ * Wake worker and wait until it ends.
+ * Frame that was being built is dropped.
+ */
+void FrameBuilder::stop()
+{
+  if(!worker.joinable())
+    return;
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    running = false;
+  }
+  wake.notify_one();
+  worker.join();
+}
+
+
+/*!
+ * \brief FrameBuilder::request
+ * \return request to fill, then \fn submit() it
+ *
+ * GUI thread only.
+ */
+LayoutRequest &FrameBuilder::request()
+{
+  return requests.writeBuffer();
+}
+
+
+/*!
+ * \brief FrameBuilder::submit
+ *
+ * Hand filled request to worker. Request that worker
+ * didn't take yet is replaced, only the newest one is
+ * laid out. Never waits on layout, lock is only taken
+ * so worker doesn't miss the wake up.
+ */
+void FrameBuilder::submit()
+{
+  requests.writeBuffer().serial = ++submitted;
+  requests.publish();
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+  }
+  wake.notify_one();
+}
+
+
+/*!
+ * \brief FrameBuilder::wait
+ *
+ * GUI thread only. Block until frame of the last
+ * submitted request is published, so the next
+ * \fn acquire() takes it. For headless replay and
+ * tests that need the same frames on every run,
+ * widgets never wait on layout.
+ */
+void FrameBuilder::wait()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  idle.wait(lock, [this]() { return !running || (built == submitted); });
+}
+
+
+/*!
+ * \brief FrameBuilder::acquire
+ * \return true if a newer frame was taken
+ *
+ * GUI thread only. Taken frame stays in \fn frame()
+ * until the next successful call.
+ */
+bool FrameBuilder::acquire()
+{
+  return frames.acquire();
+}
+
+
+/*!
+ * \brief FrameBuilder::frame
+ * \return frame taken by the last successful \fn acquire()
+ */
+const TextFrame &FrameBuilder::frame()
+{
+  return frames.readBuffer();
+}
+
+
+/*!
+ * \brief FrameBuilder::run
+ *
+ * Worker loop. Sleep until a request arrives, merge its
+ * labels, lay them out and publish packed vertices.
+ */
+void FrameBuilder::run()
+{
+  TRACE_THREAD("layout");
+  while(true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this]() { return !running || requests.fresh(); });
+        if(!running)
+          return;
+      }
+
+      requests.acquire();
+      const LayoutRequest &req = requests.readBuffer();
+      TRACE_ZONE("layout request");
+
+      if((req.y != appliedY) || (req.x != appliedX) ||
+         (req.yStyles != appliedYStyles) || (req.xStyles != appliedXStyles))
+        {
+          layout.setText(req.y, req.x, req.yStyles, req.xStyles);
+          appliedY = req.y;
+          appliedX = req.x;
+          appliedYStyles = req.yStyles;
+          appliedXStyles = req.xStyles;
+        }
+      TextFrame &frame = frames.writeBuffer();
+      if(req.compact)
+        {
+          layout.compact();
+          std::vector<double>(appliedY).swap(appliedY);
+          std::vector<double>(appliedX).swap(appliedX);
+          std::vector<TextStyle>(appliedYStyles).swap(appliedYStyles);
+          std::vector<TextStyle>(appliedXStyles).swap(appliedXStyles);
+          std::vector<GlyphVertex>().swap(frame.vertices);
+        }
+      layout.setOrigin(req.originX, req.originY);
+      layout.setDeviceScale(req.deviceScale);
+      layout.setView(req.proj, req.pixelWidth, req.pixelHeight);
+      layout.setPlotArea(req.area);
+      layout.updateTextPositions();
+      layout.buildFrame(frame);
+
+      // other two frames are taken to be as large as this one
+      frame.layoutBytes = layout.memoryBytes() +
+          (appliedY.capacity() + appliedX.capacity()) * sizeof(double) +
+          (appliedYStyles.capacity() + appliedXStyles.capacity()) * sizeof(TextStyle) +
+          3 * frame.vertices.capacity() * sizeof(GlyphVertex);
+      frames.publish();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        built = req.serial;
+      }
+      idle.notify_all();
+
+      if(frameReady)
+        frameReady();
+    }
+}
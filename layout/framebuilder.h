@@ -0,0 +1,74 @@
+#ifndef FRAMEBUILDER_H
+#define FRAMEBUILDER_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+#include "textlayout.h"
+#include "triplebuffer.h"
+
+
+struct LayoutRequest
+{
+  std::vector<double> y;  ///< Values to print on the left axis
+  std::vector<double> x;  ///< Values to print on the bottom axis
+  std::vector<TextStyle> yStyles;     ///< Style of each value of \var y, empty for default ones
+  std::vector<TextStyle> xStyles;
+  Proj proj;              ///< Projection matrix values, after space for text is reserved
+  Proj area;              ///< Part of widget data is drawn in, framed by chrome
+  double pixelWidth;
+  double pixelHeight;
+  double originX;         ///< Vertices are placed relative to it, see \fn TextLayout::setOrigin()
+  double originY;
+  double deviceScale;     ///< Glyphs are hinted to its device pixels, see \fn TextLayout::setDeviceScale()
+  bool compact;           ///< Worker releases memory layout doesn't use, see \fn TextLayout::compact()
+  unsigned serial;        ///< Set by \fn FrameBuilder::submit()
+};
+
+
+class FrameBuilder
+{
+
+public:
+  explicit FrameBuilder();
+  ~FrameBuilder();
+
+  void start(const std::unordered_map<char, Character> &chars, int width, int height,
+             double colFactor, std::function<void()> ready);
+  void stop();
+
+  LayoutRequest &request();
+  void submit();
+  void wait();
+
+  bool acquire();
+  const TextFrame &frame();
+
+private:
+  void run();
+
+  TextLayout layout;       ///< Owned by worker thread once it's started
+  std::vector<double> appliedY;       ///< Labels layout has, so unchanged ones aren't merged again
+  std::vector<double> appliedX;
+  std::vector<TextStyle> appliedYStyles;
+  std::vector<TextStyle> appliedXStyles;
+
+  TripleBuffer<LayoutRequest> requests;   ///< GUI thread to worker
+  TripleBuffer<TextFrame> frames;         ///< Worker to GUI thread
+  std::function<void()> frameReady;       ///< Called by worker after a frame is published
+
+  std::thread worker;
+  std::atomic<bool> running;
+  std::mutex mutex;        ///< Guards sleep of worker and \var built
+  std::condition_variable wake;
+  std::condition_variable idle;       ///< Worker published frame of the newest request
+  unsigned submitted;      ///< Serial of the newest request, GUI thread only
+  unsigned built;          ///< Serial of request the newest frame was built for
+};
+
+
+#endif // FRAMEBUILDER_H
@@ -0,0 +1,308 @@
+#include "textlayout.h"
+#include "textmetrics.h"
+#include "linebuffer.h"
+#include "matrixlabels.h"
+#include <stdio.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <unordered_map>
+
+#define BENCH_ROUNDS 20000      ///< Calls timed per benchmark
+
+
+static int failures = 0;
+
+
+/*!
+ * \brief check
+ * \param ok condition that should hold
+ * \param what printed if it doesn't
+ */
+static void check(bool ok, const char *what)
+{
+  if(ok)
+    return;
+  fprintf(stderr, "FAILED: %s\n", what);
+  failures++;
+}
+
+
+/*!
+ * \brief wholePixels
+ * \param value position in values of projection matrix
+ * \param pixel size of pixel
+ * \return true if \param value is a whole number of pixels
+ */
+static bool wholePixels(double value, double pixel)
+{
+  double pixels = value / pixel;
+  return fabs(pixels - floor(pixels + 0.5)) < 1e-6;
+}
+
+
+/*!
+ * \brief glyphs
+ * \return metrics of digits, comma, minus and space,
+ *    8 x 12 pixels cell, every glyph 7 pixels apart
+ */
+static std::unordered_map<char, Character> glyphs()
+{
+  std::unordered_map<char, Character> chars;
+  std::string set = "0123456789,- ";
+  for(size_t i = 0; i < set.size(); i++)
+    {
+      Character character = { 8, 12, 1, 10, 7, 1, 8, i / static_cast<double>(set.size() + 1), 0.0 };
+      chars[set[i]] = character;
+    }
+  return chars;
+}
+
+
+static void testCharFromFloat()
+{
+  const double values[] = { 0, 100, 2.5, -3, 1234567, 0.125 };
+  const char *texts[] = { "0", "100", "2,5", "-3", "1234567", "0,125" };
+  for(size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++)
+    {
+      std::vector<char> number;
+      TextLayout::getCharFromFloat(&number, values[i]);
+      check(std::string(number.begin(), number.end()) == texts[i], texts[i]);
+    }
+}
+
+
+static void testHintToPixel()
+{
+  check(TextLayout::hintToPixel(10.4, 1) == 10, "hintToPixel rounds down");
+  check(TextLayout::hintToPixel(10.995, 1) == 11, "hintToPixel takes almost whole pixel");
+  check(TextLayout::hintToPixel(-2.5, 1) == -3, "hintToPixel of negative value");
+  check(TextLayout::hintToPixel(3.3, 0.5) == 3, "hintToPixel of half pixels");
+  check(wholePixels(TextLayout::hintToPixel(1e9 + 0.37, 0.25), 0.25), "hintToPixel far from zero");
+}
+
+
+static void testReserveSpace()
+{
+  Proj proj = { 0, 400, 0, 200 };
+  TextMetrics metrics;
+  metrics.setCharacterSize(8, 12);
+  metrics.setProjMatrix(proj);
+  metrics.setPixelWidth(1);
+  metrics.setPixelHeight(1);
+  std::vector<double> labels;
+  labels.push_back(0);
+  labels.push_back(150);
+  metrics.measureLabels(labels);
+  metrics.reserveSpace(400, 200);
+
+  const Proj &reserved = metrics.getProjMatrix();
+  check(reserved.left < proj.left, "reserveSpace widens to the left for labels");
+  check(reserved.bottom < proj.bottom, "reserveSpace widens to the bottom for labels");
+  check(reserved.right >= proj.right && reserved.top >= proj.top, "reserveSpace keeps view");
+  check(metrics.getPixelWidth() > 1 && metrics.getPixelHeight() > 1, "reserveSpace makes pixels larger");
+  check(wholePixels(reserved.left, metrics.getPixelWidth()) &&
+        wholePixels(reserved.bottom, metrics.getPixelHeight()), "reserveSpace snaps edges to pixels");
+}
+
+
+static void testPlaceString()
+{
+  TextLayout layout;
+  layout.setGlyphs(glyphs(), 7, 12, 1.0 / 14);
+  Proj proj = { 0, 400, 0, 200 };
+  layout.setView(proj, 1, 1);
+
+  std::vector<GlyphVertex> out(6 * 8);
+  check(layout.placeString("12", 10.3, 20.6, defaultTextStyle, out.data(), 8) == 2, "placeString writes glyphs");
+  check(out[0].x == 11 && out[1].y == 20, "placeString hints to pixels");
+  check(out[6].x - out[0].x == 7, "placeString advances pen");
+  check(layout.placeString("1x2", 0, 0, defaultTextStyle, out.data(), 8) == 2, "placeString skips missing glyphs");
+  check(layout.placeString("12345", 0, 0, defaultTextStyle, out.data(), 3) == 3, "placeString cuts at maxGlyphs");
+
+  layout.setDeviceScale(1.5);
+  layout.placeString("12", 10.3, 20.6, defaultTextStyle, out.data(), 8);
+  check(wholePixels(out[0].x, 1 / 1.5) && wholePixels(out[6].x, 1 / 1.5), "placeString hints to device pixels");
+  check(fabs((out[2].x - out[0].x) - 12 / 1.5) < 1e-6, "placeString sizes quad to atlas cell");
+
+  layout.setDeviceScale(1);
+  layout.setOrigin(1e9, 0);
+  proj.left += 1e9;
+  proj.right += 1e9;
+  layout.setView(proj, 1, 1);
+  layout.placeString("12", 1e9 + 10.3, 20.6, defaultTextStyle, out.data(), 8);
+  check(out[0].x == 11 && out[6].x == 18, "placeString is relative to origin");
+
+  // "1" is 7 pixels wide and 13 high, centered it's 3.5 and 6.5 pixels
+  // from anchor, 7 and 13 device pixels at scale 2
+  TextLayout odd;
+  odd.setGlyphs(glyphs(), 7, 13, 1.0 / 14);
+  odd.setView(proj, 1, 1);
+  odd.setDeviceScale(2);
+  TextAnchor centered = { 90, alignCenter, alignCenter };
+  check(odd.placeString("1", 0, 0, defaultTextStyle, centered, out.data(), 8) == 1, "anchored placeString writes glyph");
+  check(out[1].dx == -7 + 2 && out[1].dy == -13, "anchored placeString centers in device pixels");
+}
+
+
+/*!
+ * \brief lineText
+ * \param buffer lines
+ * \param index line number
+ * \return copy of line
+ */
+static std::string lineText(const LineBuffer &buffer, size_t index)
+{
+  size_t length = 0;
+  const char *text = buffer.line(index, &length);
+  return std::string(text, length);
+}
+
+
+static void testLineBuffer()
+{
+  LineBuffer buffer;
+  const char text[] = "first\r\nsecond\n\r\nlast";
+  check(buffer.appendText(text, sizeof(text) - 1) == 4, "appendText counts unterminated last line");
+  check(lineText(buffer, 0) == "first" && lineText(buffer, 1) == "second", "appendText drops \\r\\n");
+  check(lineText(buffer, 2).empty() && lineText(buffer, 3) == "last", "appendText keeps empty and last line");
+  check(buffer.appendText("x\n", 2) == 1 && buffer.lines() == 5, "appendText adds no line after final break");
+
+  // the second line ends exactly at the end of the first chunk,
+  // the third one doesn't fit there and starts the next chunk
+  buffer.clear();
+  std::string fill(LINE_CHUNK_BYTES - 3, 'a');
+  buffer.append(fill);
+  buffer.append("bcd");
+  buffer.append("efg");
+  size_t length = 0;
+  const char *first = buffer.line(0, &length);
+  check(buffer.line(1, &length) == first + fill.size(), "line on chunk boundary stays in chunk");
+  check(buffer.line(2, &length) != first + LINE_CHUNK_BYTES, "next line starts new chunk");
+  check(lineText(buffer, 1) == "bcd" && lineText(buffer, 2) == "efg", "lines around chunk boundary");
+
+  std::string longLine(LINE_CHUNK_BYTES + 10, 'b');
+  longLine[LINE_CHUNK_BYTES - 1] = 'c';
+  buffer.append(longLine);
+  check(lineText(buffer, 3).size() == LINE_CHUNK_BYTES && lineText(buffer, 3)[LINE_CHUNK_BYTES - 1] == 'c',
+        "line longer than chunk is cut to it");
+  buffer.append("h");
+  check(buffer.lines() == 5 && lineText(buffer, 4) == "h", "line after cut one starts new chunk");
+  check(lineText(buffer, 0) == fill && lineText(buffer, 2) == "efg", "line() finds lines of earlier chunks");
+  check(buffer.bytes() == fill.size() + 6 + LINE_CHUNK_BYTES + 1, "bytes counts stored characters");
+}
+
+
+static void testMatrixLabels()
+{
+  // 200 x 200 cells of 10 x 10, 40 pixels each, so 5 digits fit to cell
+  std::vector<double> values(200 * 200, 1);
+  Proj area = { 0, 2000, 0, 2000 };
+  MatrixLabels labels;
+  labels.setGlyphs(glyphs(), 7, 12, 1.0 / 14);
+  labels.setMatrix(values.data(), 200, 200, 200, area);
+
+  Proj view = { 0, 100, 1900, 2000 };
+  labels.setView(view, 0.25, 0.25);
+  check(labels.update() == 100 && labels.allChanged() && labels.changedSlots().size() == 100,
+        "matrix labels lay out all visible cells first");
+
+  // column 10 comes into view and takes slots of column 0
+  view.left += 10;
+  view.right += 10;
+  labels.setView(view, 0.25, 0.25);
+  std::vector<size_t> column;
+  for(size_t row = 0; row < 10; row++)
+    column.push_back(row * 10);
+  check(labels.update() == 100 && !labels.allChanged() && labels.changedSlots() == column,
+        "pan lays out only slots of new column");
+
+  // row 10 comes into view and takes slots of row 0
+  view.bottom -= 10;
+  view.top -= 10;
+  labels.setView(view, 0.25, 0.25);
+  std::vector<size_t> row;
+  for(size_t i = 0; i < 10; i++)
+    row.push_back(i);
+  check(labels.update() == 100 && labels.changedSlots() == row, "pan lays out only slots of new row");
+
+  check(labels.update() == 100 && labels.changedSlots().empty(), "nothing changes without pan");
+
+  values[5 * 200 + 5] = 77;
+  labels.touchCell(5, 5);
+  labels.touchCell(0, 0);
+  check(labels.update() == 100 && labels.changedSlots() == std::vector<size_t>(1, 55),
+        "changed cell lays out only its slot");
+  const GlyphVertex *cell = labels.slotVertices(55);
+  check((cell[0].x != 0) && (cell[6].x != 0) && (cell[12].x == 0) && (cell[12].y == 0),
+        "slot holds glyphs of new value only");
+
+  labels.setView(view, 1, 1);
+  check(labels.update() == 0, "labels hide below 3 characters per cell");
+
+  labels.setView(area, 0.25, 0.25);
+  check(labels.update() == 0, "labels hide above MATRIX_MAX_CELLS cells");
+
+  labels.setView(view, 0.25, 0.25);
+  check(labels.update() == 100 && labels.allChanged(), "shown labels are laid out again");
+}
+
+
+/*!
+ * \brief bench
+ * \param name printed with time of one call
+ * \param run benchmarked call
+ */
+template <typename F>
+static void bench(const char *name, F run)
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for(int i = 0; i < BENCH_ROUNDS; i++)
+    run(i);
+  std::chrono::duration<double, std::nano> time = std::chrono::steady_clock::now() - start;
+  printf("%-20s %10.1f ns\n", name, time.count() / BENCH_ROUNDS);
+}
+
+
+/*!
+ * \brief main
+ *
+ * Headless checks and benchmarks of GL-free text layout,
+ * registered with CTest. Returns number of failed checks,
+ * times are only printed, they depend on machine.
+ */
+int main()
+{
+  testCharFromFloat();
+  testHintToPixel();
+  testReserveSpace();
+  testPlaceString();
+  testLineBuffer();
+  testMatrixLabels();
+
+  TextLayout layout;
+  layout.setGlyphs(glyphs(), 7, 12, 1.0 / 14);
+  Proj proj = { 0, 400, 0, 200 };
+  layout.setView(proj, 1, 1);
+  std::vector<GlyphVertex> out(6 * 16);
+  std::vector<char> number;
+  volatile double sink = 0;
+
+  bench("getCharFromFloat", [&](int i) { number.clear(); TextLayout::getCharFromFloat(&number, i * 0.25); });
+  bench("hintToPixel", [&](int i) { sink = sink + TextLayout::hintToPixel(i * 0.37, 0.25); });
+  bench("placeString", [&](int i) { layout.placeString("-1234,5678", i % 300, 20, defaultTextStyle, out.data(), 16); });
+  bench("reserveSpace", [&](int i)
+    {
+      TextMetrics metrics;
+      metrics.setCharacterSize(8, 12);
+      metrics.setProjMatrix(proj);
+      metrics.setPixelWidth(1 + (i % 4));
+      metrics.setPixelHeight(1);
+      metrics.reserveSpace(400, 200);
+    });
+
+  if(failures > 0)
+    fprintf(stderr, "%d checks failed\n", failures);
+  return failures;
+}
@@ -0,0 +1,28 @@
+#ifndef LAYOUTTYPES_H
+#define LAYOUTTYPES_H
+
+
+struct Proj
+{
+  double left;            ///< Values stay double, far from zero floats can't tell pixels apart
+  double right;
+  double bottom;
+  double top;
+};
+
+
+struct Character
+{
+  unsigned sizex;
+  unsigned sizey;
+  int BearingX;
+  int BearingY;
+  int Advance;
+  int BoldBearingX;       ///< Metrics of glyph in bold layer of texture atlas
+  int BoldAdvance;
+  double texX;
+  double texY;
+};
+
+
+#endif // LAYOUTTYPES_H
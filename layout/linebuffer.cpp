@@ -0,0 +1,95 @@
+#include "linebuffer.h"
+#include <string.h>
+
+
+LineBuffer::LineBuffer()
+{
+  chunkUsed = 0;
+  stored = 0;
+}
+
+
+LineBuffer::~LineBuffer()
+{
+
+}
+
+
+/*!
+ * \brief LineBuffer::append
+ * \param text characters of line, without line break
+ * \param length number of characters
+ *
+ * Line that doesn't fit to the rest of the last chunk
+ * starts a new one, so lines are never moved once
+ * stored. Amortized cost is a copy of \param text.
+ */
+void LineBuffer::append(const char *text, size_t length)
+{
+  if(length > LINE_CHUNK_BYTES)
+    length = LINE_CHUNK_BYTES;
+
+  if(chunks.empty() || (chunkUsed + length > LINE_CHUNK_BYTES))
+    {
+      chunks.push_back(std::unique_ptr<char[]>(new char[LINE_CHUNK_BYTES]));
+      chunkUsed = 0;
+    }
+
+  memcpy(chunks.back().get() + chunkUsed, text, length);
+  lineStart.push_back((static_cast<uint64_t>(chunks.size() - 1) << 32) | chunkUsed);
+  lineLength.push_back(static_cast<uint32_t>(length));
+  chunkUsed += length;
+  stored += length;
+}
+
+
+/*!
+ * \brief LineBuffer::append
+ * \param line text of line, without line break
+ */
+void LineBuffer::append(const std::string &line)
+{
+  append(line.data(), line.size());
+}
+
+
+/*!
+ * \brief LineBuffer::appendText
+ * \param text lines separated by '\n', "\r\n" is accepted too
+ * \param length number of characters
+ * \return number of lines appended
+ *
+ * Text after the last line break is a line too.
+ */
+size_t LineBuffer::appendText(const char *text, size_t length)
+{
+  size_t added = 0;
+  const char *end = text + length;
+  while(text < end)
+    {
+      const char *brk = static_cast<const char *>(memchr(text, '\n', end - text));
+      const char *next = (brk != nullptr) ? brk + 1 : end;
+      const char *last = (brk != nullptr) ? brk : end;
+      if((last > text) && (last[-1] == '\r'))
+        last--;
+      append(text, last - text);
+      added++;
+      text = next;
+    }
+  return added;
+}
+
+
+/*!
+ * \brief LineBuffer::clear
+ *
+ * Release all chunks and index.
+ */
+void LineBuffer::clear()
+{
+  chunks.clear();
+  chunkUsed = 0;
+  lineStart.clear();
+  lineLength.clear();
+  stored = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef LINEBUFFER_H
+#define LINEBUFFER_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+#define LINE_CHUNK_BYTES (1 << 20)    ///< Characters of one chunk, longer lines are cut to it
+
+
+/*!
+ * \brief The LineBuffer class
+ *
+ * Append only store of text lines. Characters are packed
+ * into chunks that are never moved or reallocated, line
+ * never spans two chunks. Line offsets are kept in an
+ * index, so any line is found in constant time no matter
+ * how many lines are stored.
+ */
+class LineBuffer
+{
+
+public:
+  explicit LineBuffer();
+  ~LineBuffer();
+
+  void append(const char *text, size_t length);
+  void append(const std::string &line);
+  size_t appendText(const char *text, size_t length);
+  void clear();
+
+  inline size_t lines() const;
+  inline size_t bytes() const;
+  inline const char *line(size_t index, size_t *length) const;
+
+private:
+  std::vector<std::unique_ptr<char[]> > chunks;
+  size_t chunkUsed;                ///< Characters used in the last chunk
+  std::vector<uint64_t> lineStart; ///< Chunk of line in high 32 bits, offset in it in low ones
+  std::vector<uint32_t> lineLength;
+  size_t stored;                   ///< Characters of all lines
+};
+
+
+inline size_t LineBuffer::lines() const
+{
+  return lineStart.size();
+}
+
+
+inline size_t LineBuffer::bytes() const
+{
+  return stored;
+}
+
+
+/*!
+ * \brief LineBuffer::line
+ * \param index line number, less than \fn lines()
+ * \param length characters of line, no terminating zero
+ * \return characters, valid until \fn clear()
+ */
+inline const char *LineBuffer::line(size_t index, size_t *length) const
+{
+  uint64_t start = lineStart[index];
+  *length = lineLength[index];
+  return chunks[start >> 32].get() + (start & 0xFFFFFFFFu);
+}
+
+
+#endif // LINEBUFFER_H
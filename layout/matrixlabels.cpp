@@ -0,0 +1,355 @@
+#include "matrixlabels.h"
+#include "tracezones.h"
+#include <algorithm>
+#include <string>
+#include <stdio.h>
+#include <math.h>
+
+#define MATRIX_NO_CELL static_cast<size_t>(-1)
+
+
+MatrixLabels::MatrixLabels()
+{
+  characterWidth = 1;
+  characterHeight = 1;
+  values = nullptr;
+  rows = 0;
+  columns = 0;
+  stride = 0;
+  area.left = 0;
+  area.right = 0;
+  area.bottom = 0;
+  area.top = 0;
+  view = area;
+  pixelWidth = 1;
+  pixelHeight = 1;
+  placedPixelWidth = 0;
+  placedPixelHeight = 0;
+  originX = 0;
+  originY = 0;
+  deviceScale = 1;
+  cellChars = 0;
+  firstRow = 0;
+  firstColumn = 0;
+  ringRows = 0;
+  ringColumns = 0;
+  relayout = true;
+  relaidOut = false;
+}
+
+
+MatrixLabels::~MatrixLabels()
+{
+
+}
+
+
+/*!
+ * \brief MatrixLabels::setGlyphs
+ * \param chars glyph metrics of texture atlas
+ * \param width advance of digit in pixels
+ * \param height height of glyph cell in pixels
+ * \param factor width of one glyph in texture atlas
+ */
+void MatrixLabels::setGlyphs(const std::unordered_map<char, Character> &chars, int width, int height, double factor)
+{
+  layout.setGlyphs(chars, width, height, factor);
+  characterWidth = (width > 0) ? width : 1;
+  characterHeight = (height > 0) ? height : 1;
+  relayout = true;
+}
+
+
+/*!
+ * \brief MatrixLabels::setMatrix
+ * \param data values, kept by caller while matrix is shown,
+ *    null to remove matrix
+ * \param rowCount rows of matrix
+ * \param columnCount columns of matrix
+ * \param rowStride values from one row to the next one, at
+ *    least \param columnCount
+ * \param cells values matrix covers, row 0 at the top
+ *
+ * Nothing is read here, cells are formatted when
+ * they come into view.
+ */
+void MatrixLabels::setMatrix(const double *data, size_t rowCount, size_t columnCount, size_t rowStride,
+                             const Proj &cells)
+{
+  values = data;
+  rows = rowCount;
+  columns = columnCount;
+  stride = rowStride;
+  area = cells;
+  relayout = true;
+}
+
+
+/*!
+ * \brief MatrixLabels::touchCell
+ * \param row cell which value changed
+ * \param column
+ *
+ * Only visible cell is queued, the others are
+ * read when they come into view anyway.
+ */
+void MatrixLabels::touchCell(size_t row, size_t column)
+{
+  if(relayout || (ringRows == 0) || (ringColumns == 0) ||
+     (row < firstRow) || (row >= firstRow + ringRows) ||
+     (column < firstColumn) || (column >= firstColumn + ringColumns))
+    return;
+
+  touchSlot((row % ringRows) * ringColumns + column % ringColumns);
+}
+
+
+/*!
+ * \brief MatrixLabels::touchAll
+ *
+ * All values changed, e.g. buffer was refilled.
+ */
+void MatrixLabels::touchAll()
+{
+  relayout = true;
+}
+
+
+/*!
+ * \brief MatrixLabels::setView
+ * \param visible part of widget data is drawn in
+ * \param pxWidth width of pixel in values of projection matrix
+ * \param pxHeight height of pixel
+ */
+void MatrixLabels::setView(const Proj &visible, double pxWidth, double pxHeight)
+{
+  view = visible;
+  pixelWidth = pxWidth;
+  pixelHeight = pxHeight;
+}
+
+
+/*!
+ * \brief MatrixLabels::setOrigin
+ * \param x position vertices are placed relative to, see \fn TextLayout::setOrigin()
+ * \param y
+ */
+void MatrixLabels::setOrigin(double x, double y)
+{
+  if((x == originX) && (y == originY))
+    return;
+  originX = x;
+  originY = y;
+  layout.setOrigin(x, y);
+  relayout = true;
+}
+
+
+/*!
+ * \brief MatrixLabels::setDeviceScale
+ * \param scale device pixel ratio, see \fn TextLayout::setDeviceScale()
+ */
+void MatrixLabels::setDeviceScale(double scale)
+{
+  if(scale == deviceScale)
+    return;
+  deviceScale = scale;
+  layout.setDeviceScale(scale);
+  relayout = true;
+}
+
+
+/*!
+ * \brief MatrixLabels::touchSlot
+ * \param slot slot to lay out at the next \fn update()
+ */
+void MatrixLabels::touchSlot(size_t slot)
+{
+  if(slotDirty[slot])
+    return;
+  slotDirty[slot] = 1;
+  dirtySlots.push_back(slot);
+}
+
+
+/*!
+ * \brief MatrixLabels::update
+ * \return number of slots to draw, 0 if labels are hidden
+ *
+ * Find cells fully inside view and lay out slots which
+ * cell or value changed, see \fn changedSlots(). Labels
+ * are hidden when fewer than MATRIX_MIN_CELL_CHARS digits
+ * fit to cell or more than MATRIX_MAX_CELLS are visible.
+ * Cost depends on changed cells, not on size of matrix.
+ */
+size_t MatrixLabels::update()
+{
+  TRACE_ZONE("matrix labels");
+  changed.clear();
+  relaidOut = false;
+  if((values == nullptr) || (rows == 0) || (columns == 0) || (pixelWidth <= 0) || (pixelHeight <= 0))
+    return 0;
+
+  double cellWidth = (area.right - area.left) / columns;
+  double cellHeight = (area.top - area.bottom) / rows;
+  double left = std::max(0.0, ceil((view.left - area.left) / cellWidth - 1e-9));
+  double right = std::min(static_cast<double>(columns), floor((view.right - area.left) / cellWidth + 1e-9));
+  double top = std::max(0.0, ceil((area.top - view.top) / cellHeight - 1e-9));
+  double bottom = std::min(static_cast<double>(rows), floor((area.top - view.bottom) / cellHeight + 1e-9));
+
+  cellChars = std::min(static_cast<int>(cellWidth / pixelWidth) / characterWidth, MATRIX_CELL_GLYPHS);
+  if((right <= left) || (bottom <= top) || (cellChars < MATRIX_MIN_CELL_CHARS) ||
+     (cellHeight / pixelHeight < characterHeight) || ((right - left) * (bottom - top) > MATRIX_MAX_CELLS))
+    {
+      // slots are left as they are and laid out again when labels show up
+      relayout = true;
+      return 0;
+    }
+
+  size_t newRows = static_cast<size_t>(bottom - top);
+  size_t newColumns = static_cast<size_t>(right - left);
+  if((newRows != ringRows) || (newColumns != ringColumns))
+    {
+      ringRows = newRows;
+      ringColumns = newColumns;
+      slotCell.assign(ringRows * ringColumns, MATRIX_NO_CELL);
+      slotDirty.assign(ringRows * ringColumns, 0);
+      vertices.resize(ringRows * ringColumns * MATRIX_CELL_VERTICES);
+      dirtySlots.clear();
+      relayout = true;
+    }
+
+  if((fabs(pixelWidth - placedPixelWidth) > pixelWidth * 1e-6) ||
+     (fabs(pixelHeight - placedPixelHeight) > pixelHeight * 1e-6))
+    {
+      placedPixelWidth = pixelWidth;
+      placedPixelHeight = pixelHeight;
+      layout.setView(view, pixelWidth, pixelHeight);
+      relayout = true;
+    }
+
+  size_t newFirstRow = static_cast<size_t>(top);
+  size_t newFirstColumn = static_cast<size_t>(left);
+  if(relayout || (newFirstRow != firstRow) || (newFirstColumn != firstColumn))
+    {
+      firstRow = newFirstRow;
+      firstColumn = newFirstColumn;
+      for(size_t row = firstRow; row < firstRow + ringRows; row++)
+        for(size_t column = firstColumn; column < firstColumn + ringColumns; column++)
+          {
+            size_t slot = (row % ringRows) * ringColumns + column % ringColumns;
+            size_t cell = row * columns + column;
+            if(!relayout && (slotCell[slot] == cell))
+              continue;
+            slotCell[slot] = cell;
+            touchSlot(slot);
+          }
+    }
+
+  changed.swap(dirtySlots);
+  for(size_t i = 0; i < changed.size(); i++)
+    {
+      slotDirty[changed[i]] = 0;
+      layoutSlot(changed[i]);
+    }
+  std::sort(changed.begin(), changed.end());
+  relaidOut = relayout;
+  relayout = false;
+  return ringRows * ringColumns;
+}
+
+
+/*!
+ * \brief MatrixLabels::memoryBytes
+ * \return bytes held by slots and glyph metrics
+ */
+size_t MatrixLabels::memoryBytes() const
+{
+  return layout.memoryBytes() + (slotCell.capacity() + dirtySlots.capacity() + changed.capacity()) * sizeof(size_t) +
+         slotDirty.capacity() + vertices.capacity() * sizeof(GlyphVertex);
+}
+
+
+/*!
+ * \brief MatrixLabels::compact
+ *
+ * Release capacity slots don't use, e.g. after view
+ * showed more cells than now. Slots of hidden labels
+ * are released, they're laid out again when labels
+ * show up.
+ */
+void MatrixLabels::compact()
+{
+  if(relayout)
+    {
+      ringRows = 0;
+      ringColumns = 0;
+      std::vector<size_t>().swap(slotCell);
+      std::vector<char>().swap(slotDirty);
+      std::vector<size_t>().swap(dirtySlots);
+      std::vector<GlyphVertex>().swap(vertices);
+    }
+  else
+    {
+      std::vector<size_t>(dirtySlots).swap(dirtySlots);
+      std::vector<GlyphVertex>(vertices).swap(vertices);
+    }
+  std::vector<size_t>(changed).swap(changed);
+  layout.compact();
+}
+
+
+/*!
+ * \brief MatrixLabels::layoutSlot
+ * \param slot slot to fill with value of its cell
+ *
+ * Value is centered in cell. Vertices of unused
+ * glyphs are zeroed, so their triangles are
+ * degenerate and not drawn.
+ */
+void MatrixLabels::layoutSlot(size_t slot)
+{
+  GlyphVertex empty = {};
+  GlyphVertex *out = &vertices[slot * MATRIX_CELL_VERTICES];
+  size_t row = slotCell[slot] / columns;
+  size_t column = slotCell[slot] % columns;
+
+  char print[32];
+  int length = formatValue(values[row * stride + column], print);
+  size_t glyphs = 0;
+  if(length > 0)
+    {
+      std::string text(print, length);
+      double cellWidth = (area.right - area.left) / columns;
+      double cellHeight = (area.top - area.bottom) / rows;
+      double x = area.left + (column + 0.5) * cellWidth - layout.measureString(text, defaultTextStyle) * pixelWidth / 2;
+      double y = area.top - (row + 0.5) * cellHeight - characterHeight * pixelHeight / 2;
+      glyphs = layout.placeString(text, x, y, defaultTextStyle, out, MATRIX_CELL_GLYPHS);
+    }
+
+  std::fill(out + glyphs * 6, out + MATRIX_CELL_VERTICES, empty);
+}
+
+
+/*!
+ * \brief MatrixLabels::formatValue
+ * \param value value of cell
+ * \param out characters of value, at least 32 of them
+ * \return number of characters, 0 if value doesn't fit to cell
+ *
+ * Value is printed with as many significant digits
+ * as fit to \var cellChars.
+ */
+int MatrixLabels::formatValue(double value, char *out)
+{
+  if(value != value)
+    return 0;
+
+  for(int precision = cellChars; precision > 0; precision--)
+    {
+      int length = snprintf(out, 32, "%.*g", precision, value);
+      if((length > 0) && (length <= cellChars))
+        return length;
+    }
+  return 0;
+}
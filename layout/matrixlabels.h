@@ -0,0 +1,115 @@
+#ifndef MATRIXLABELS_H
+#define MATRIXLABELS_H
+
+#include <vector>
+#include <unordered_map>
+#include <stddef.h>
+
+#include "layouttypes.h"
+#include "textlayout.h"
+
+#define MATRIX_CELL_GLYPHS 8      ///< Most glyphs printed in one cell
+#define MATRIX_CELL_VERTICES (MATRIX_CELL_GLYPHS * 6)
+#define MATRIX_MIN_CELL_CHARS 3   ///< Labels are hidden when fewer digits fit to cell
+#define MATRIX_MAX_CELLS 16384    ///< Labels are hidden when more cells are visible
+
+
+/*!
+ * \brief The MatrixLabels class
+ *
+ * Value of every visible cell of a matrix, e.g. heatmap,
+ * printed in its center. Values are read from caller
+ * buffer and formatted only for cells fully inside view.
+ * Each visible cell has a fixed slot of vertices in a
+ * ring as large as view, so pan lays out only cells that
+ * came into view and a changed value only its own slot.
+ * Zoom lays out all visible cells again. Needs no context.
+ */
+class MatrixLabels
+{
+
+public:
+  explicit MatrixLabels();
+  ~MatrixLabels();
+
+  void setGlyphs(const std::unordered_map<char, Character> &chars, int width, int height, double factor);
+  void setMatrix(const double *data, size_t rowCount, size_t columnCount, size_t rowStride, const Proj &cells);
+  void touchCell(size_t row, size_t column);
+  void touchAll();
+  void setView(const Proj &visible, double pxWidth, double pxHeight);
+  void setOrigin(double x, double y);
+  void setDeviceScale(double scale);
+  size_t update();
+  size_t memoryBytes() const;
+  void compact();
+
+  inline bool allChanged() const;
+  inline const std::vector<size_t> &changedSlots() const;
+  inline const GlyphVertex *slotVertices(size_t slot) const;
+
+private:
+  void touchSlot(size_t slot);
+  void layoutSlot(size_t slot);
+  int formatValue(double value, char *out);
+
+  TextLayout layout;       ///< Places glyphs of cells, pixel sizes of view
+  int characterWidth;
+  int characterHeight;
+
+  const double *values;    ///< Caller buffer, null if there is no matrix
+  size_t rows;
+  size_t columns;
+  size_t stride;           ///< Values from one row to the next one
+  Proj area;               ///< Values matrix covers, row 0 is at the top
+
+  Proj view;               ///< Part of widget data is drawn in, only cells fully inside it are printed
+  double pixelWidth;
+  double pixelHeight;
+  double placedPixelWidth; ///< Pixel sizes slots were laid out for
+  double placedPixelHeight;
+  double originX;          ///< Vertices are relative to it
+  double originY;
+  double deviceScale;      ///< Device pixel ratio glyphs are hinted to
+  int cellChars;           ///< Characters that fit to cell
+
+  size_t firstRow;         ///< Visible cells, as of the last \fn update()
+  size_t firstColumn;
+  size_t ringRows;         ///< Visible rows and columns, slot of cell is its position modulo these
+  size_t ringColumns;
+  std::vector<size_t> slotCell;   ///< row * \var columns + column of cell in slot
+  std::vector<char> slotDirty;    ///< Slot is queued in \var dirtySlots
+  std::vector<size_t> dirtySlots; ///< Slots to lay out at the next \fn update()
+  std::vector<size_t> changed;    ///< Slots laid out by the last \fn update(), to load
+  std::vector<GlyphVertex> vertices;   ///< MATRIX_CELL_VERTICES per slot
+  bool relayout;           ///< All slots should be laid out again
+  bool relaidOut;          ///< All slots were laid out by the last \fn update()
+};
+
+
+/*!
+ * \brief MatrixLabels::allChanged
+ * \return every slot changed in the last \fn update()
+ */
+inline bool MatrixLabels::allChanged() const
+{
+  return relaidOut;
+}
+
+
+/*!
+ * \brief MatrixLabels::changedSlots
+ * \return slots changed in the last \fn update(), ascending
+ */
+inline const std::vector<size_t> &MatrixLabels::changedSlots() const
+{
+  return changed;
+}
+
+
+inline const GlyphVertex *MatrixLabels::slotVertices(size_t slot) const
+{
+  return &vertices[slot * MATRIX_CELL_VERTICES];
+}
+
+
+#endif // MATRIXLABELS_H
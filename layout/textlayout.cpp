@@ -0,0 +1,854 @@
+#include "textlayout.h"
+#include "tracezones.h"
+#include <math.h>
+#include <algorithm>
+
+
+const TextStyle defaultTextStyle = { { 0, 0, 0, 255 }, 0 };
+const TextStyle gridStyle = { { 0, 0, 0, 40 }, 0 };
+const TextAnchor defaultAnchor = { 0, alignStart, alignStart };
+
+
+TextLayout::TextLayout()
+{
+  characterWidth = 0;
+  cellWidth = 0;
+  characterHeight = 0;
+  colFactor = 0;
+  deviceScale = 1;
+  quadWidth = 0;
+  quadHeight = 0;
+  version[horizontal] = 0;
+  version[vertical] = 0;
+  pixelWidth = 0;
+  pixelHeight = 0;
+  proj.left = 0;
+  proj.right = 0;
+  proj.bottom = 0;
+  proj.top = 0;
+  placedPixelWidth = 0;
+  placedPixelHeight = 0;
+  placedProj = proj;
+  plotArea = proj;
+  originX = 0;
+  originY = 0;
+  for(int i = 0; i < 4; i++)
+    areaPixels[i] = 0;
+}
+
+
+TextLayout::~TextLayout()
+{
+
+}
+
+
+/*!
+ * \brief TextLayout::setGlyphs
+ * \param chars glyph metrics and atlas positions
+ * \param width width of glyph cell in pixels
+ * \param height height of glyph cell in pixels
+ * \param factor width of one glyph in texture atlas
+ *
+ * Layout works on its own copy of metrics, so it
+ * can run on any thread. Labels are laid out again.
+ * All cells of atlas are of the same size.
+ */
+void TextLayout::setGlyphs(const std::unordered_map<char, Character> &chars, int width, int height, double factor)
+{
+  Characters = chars;
+  characterWidth = width;
+  cellWidth = chars.empty() ? width : chars.begin()->second.sizex;
+  characterHeight = height;
+  colFactor = factor;
+  updateQuadSize();
+  textBoxes.clear();
+  placedPixelWidth = 0;
+  placedPixelHeight = 0;
+  version[horizontal]++;
+  version[vertical]++;
+}
+
+
+/*!
+ * \brief TextLayout::setView
+ * \param pr projection matrix values, after space for text is reserved
+ * \param pxWidth width of pixel in values of \param pr
+ * \param pxHeight height of pixel in values of \param pr
+ */
+void TextLayout::setView(const Proj &pr, double pxWidth, double pxHeight)
+{
+  proj = pr;
+  pixelWidth = pxWidth;
+  pixelHeight = pxHeight;
+}
+
+
+/*!
+ * \brief TextLayout::setOrigin
+ * \param x position vertices are placed relative to, in
+ *    values of projection matrix, should be a whole pixel
+ * \param y
+ *
+ * Vertices are floats, so far from zero they can't hold
+ * pixels anymore. Positions are computed in double and
+ * only the offset from origin is stored. Matrix of
+ * vertices should be shifted by the same origin. Changed
+ * origin lays out all labels again.
+ */
+void TextLayout::setOrigin(double x, double y)
+{
+  if((x == originX) && (y == originY))
+    return;
+  originX = x;
+  originY = y;
+  placedPixelWidth = 0;
+  placedPixelHeight = 0;
+}
+
+
+/*!
+ * \brief TextLayout::setDeviceScale
+ * \param scale device pixel ratio of widget text is drawn in
+ *
+ * Atlas of \param scale has cells of \fn cellTexels() and
+ * one texel should be one device pixel, so glyph quads are
+ * that many device pixels big and start at whole device
+ * pixels. Metrics of glyphs stay in logical pixels. Labels
+ * are laid out again if scale changed.
+ */
+void TextLayout::setDeviceScale(double scale)
+{
+  if((scale <= 0) || (scale == deviceScale))
+    return;
+  deviceScale = scale;
+  updateQuadSize();
+  placedPixelWidth = 0;
+  placedPixelHeight = 0;
+}
+
+
+/*!
+ * \brief TextLayout::updateQuadSize
+ *
+ * Size glyph quads to cells of atlas of \var deviceScale.
+ */
+void TextLayout::updateQuadSize()
+{
+  quadWidth = cellTexels(cellWidth, deviceScale) / deviceScale;
+  quadHeight = cellTexels(characterHeight, deviceScale) / deviceScale;
+}
+
+
+/*!
+ * \brief TextLayout::cellTexels
+ * \param pixels size of glyph cell in logical pixels
+ * \param scale device pixel ratio
+ * \return size of cell in atlas rasterized for \param scale
+ *
+ * Atlases and layouts round cells the same way, here.
+ */
+int TextLayout::cellTexels(int pixels, double scale)
+{
+  return static_cast<int>(ceil(pixels * scale));
+}
+
+
+/*!
+ * \brief TextLayout::hintToPixel
+ * \param num number to hint
+ * \param pixelsize size of pixel that we need to hint \param num to.
+ * \return hinted \param num
+ *
+ * We need to make sure that some varriables are put exactly
+ * on edges of pixels. It should be done due to subpixel
+ * interpolation of text, so the rendered textures won't
+ * look fuzzy.
+ */
+double TextLayout::hintToPixel(double num, double pixelsize)
+{
+  double md;
+  double frac = modf((num / pixelsize), &md);   // hint num to be in integer size in pixels
+  if (1.0 - frac < 0.01)                        // handle almost integer size in pixels
+    ++md;
+  if (1.0 - frac > 1.0)                         // handle if value is negative
+    --md;
+  return (md * pixelsize);
+}
+
+
+/*!
+ * \brief TextLayout::getCharFromFloat
+ * \param number vector where char numbers will be stored
+ * \param input float value to divide by char numbers
+ *
+ * Simple function to slice float number into char characters
+ */
+void TextLayout::getCharFromFloat(std::vector<char> *number, double input)
+{
+  TRACE_ZONE("format");
+  double frac_part = 0;
+  double int_part = 0;
+  int offs_begin = 0;
+  int offs_end = 0;
+
+  number->reserve(MAX_CH);
+
+  frac_part = modf((input), &int_part);
+
+  if(int_part < 0)
+    {
+      number->push_back('-');
+      offs_begin = 1;
+      int_part *= -1;
+      frac_part *= -1;
+    }
+
+  if(int_part == 0)
+    {
+      number->push_back('0');
+    }
+
+
+  double add_int_part = 0;
+  char to_vector;
+  while (int_part > 0)
+    {
+      add_int_part = modf((int_part / 10), &int_part);
+      add_int_part *= 10;
+      to_vector = static_cast<char>(char('0') + (add_int_part + 0.00001));
+      number->push_back(to_vector);
+    }
+
+  if(frac_part > 0)
+    {
+      number->push_back(',');
+      ++offs_end;
+    }
+  else
+    {
+      std::reverse((number->begin() + offs_begin), number->end());
+      return;
+    }
+
+  frac_part += 0.00000001;
+  double add_frac_part = 0;
+  double a = 0.0000001;
+  while ( frac_part > 0)
+    {
+      frac_part = modf((frac_part * 10), &add_frac_part);
+      to_vector = static_cast<char>(char('0')  + (add_frac_part));
+      number->push_back(to_vector);
+      ++offs_end;
+      a *= 10;
+      if((frac_part < a) || (offs_end > MAX_CH - 2))
+        {
+          break;
+        }
+    }
+
+  std::reverse((number->begin() + offs_begin), (number->end() - offs_end));
+}
+
+
+/*!
+ * \brief TextLayout::setVertex
+ * \param vertex vertex to fill
+ * \param x position in values of projection matrix, relative to origin
+ * \param y
+ * \param s position in texture atlas
+ * \param t
+ * \param style color and atlas layer of label
+ */
+void TextLayout::setVertex(GlyphVertex &vertex, double x, double y, double s, double t, const TextStyle &style)
+{
+  vertex.x = x;
+  vertex.y = y;
+  vertex.s = s;
+  vertex.t = t;
+  vertex.dx = 0;
+  vertex.dy = 0;
+  vertex.color[0] = style.color[0];
+  vertex.color[1] = style.color[1];
+  vertex.color[2] = style.color[2];
+  vertex.color[3] = style.color[3];
+  vertex.layer = style.bold;
+  vertex.padding = 0;
+  vertex.angle = 0;
+}
+
+
+/*!
+ * \brief TextLayout::setQuad
+ * \param quad 6 vertices of glyph to fill
+ * \param x left edge of glyph cell, hinted to pixel
+ * \param y bottom edge of glyph cell, hinted to pixel
+ * \param width width of cell in values of projection matrix
+ * \param height height of cell
+ * \param texX left edge of cell in texture atlas
+ * \param style color and atlas layer of label
+ *
+ * Screen coords:
+ * 0---*    3---5
+ * | \ |    | \ |
+ * 1---2    *---4
+ * Texture coords:
+ * 1---2    *---4
+ * | / |    | / |
+ * 0---*    3---5
+ */
+void TextLayout::setQuad(GlyphVertex *quad, double x, double y, double width, double height,
+                         double texX, const TextStyle &style)
+{
+  x -= originX;
+  y -= originY;
+  setVertex(quad[0], x, y + height, texX, 0, style);
+  setVertex(quad[1], x, y, texX, 1.0, style);
+  setVertex(quad[2], x + width, y, texX + colFactor, 1.0, style);
+
+  setVertex(quad[3], x, y + height, texX, 0, style);
+  setVertex(quad[4], x + width, y, texX + colFactor, 1.0, style);
+  setVertex(quad[5], x + width, y + height, texX + colFactor, 0, style);
+}
+
+
+/*!
+ * \brief TextLayout::addSolidQuad
+ * \param out vertex stream to append 6 vertices to
+ * \param x left edge in values of projection matrix, hinted to pixel
+ * \param y bottom edge, hinted to pixel
+ * \param width width of quad
+ * \param height height of quad
+ * \param style color of quad
+ *
+ * The last cell of texture atlas is solid, every vertex
+ * samples its center, so quad is drawn with plain color
+ * by the same program and in the same batch as glyphs.
+ */
+void TextLayout::addSolidQuad(std::vector<GlyphVertex> &out, double x, double y, double width, double height,
+                              const TextStyle &style)
+{
+  double s = 1.0 - (colFactor / 2);
+  x -= originX;
+  y -= originY;
+  size_t first = out.size();
+  out.resize(first + 6);
+  GlyphVertex *quad = &out[first];
+
+  setVertex(quad[0], x, y + height, s, 0.5, style);
+  setVertex(quad[1], x, y, s, 0.5, style);
+  setVertex(quad[2], x + width, y, s, 0.5, style);
+
+  setVertex(quad[3], x, y + height, s, 0.5, style);
+  setVertex(quad[4], x + width, y, s, 0.5, style);
+  setVertex(quad[5], x + width, y + height, s, 0.5, style);
+}
+
+
+/*!
+ * \brief TextLayout::setPlotArea
+ * \param area part of widget data is drawn in, inside projection matrix
+ *
+ * Frame is drawn around \param area, grid lines and
+ * ticks of labels inside it. Empty area has no chrome.
+ */
+void TextLayout::setPlotArea(const Proj &area)
+{
+  plotArea = area;
+}
+
+
+/*!
+ * \brief TextLayout::setText
+ * \param y values to print on the left axis
+ * \param x values to print on the bottom axis
+ * \param yStyles style of each value of \param y, missing ones are \var defaultTextStyle
+ * \param xStyles style of each value of \param x
+ *
+ * Labels that are already printed are kept as they are,
+ * only values that weren't in the last call, or changed
+ * style, are sliced into characters and laid out. So when
+ * axis is scrolled, only ticks that enter the view cost anything.
+ * Style goes to every vertex, so labels of any style are
+ * still rendered in one batch.
+ * Values are expected to be sorted ascending.
+ */
+void TextLayout::setText(const std::vector<double> &y, const std::vector<double> &x,
+                         const std::vector<TextStyle> &yStyles, const std::vector<TextStyle> &xStyles)
+{
+  TRACE_ZONE("set text");
+  std::vector<Text> boxes(y.size() + x.size());
+
+  // layer changes if any of its labels is new or removed
+  unsigned old_count[2] = { 0, 0 };
+  for(unsigned i = 0; i < textBoxes.size(); i++)
+    old_count[textBoxes[i].ar]++;
+  bool changed[2] = { false, false };
+
+  unsigned old = 0;
+  for(unsigned i = 0; i < boxes.size(); i++)
+    {
+      Arrange ar = (i < y.size()) ? vertical : horizontal;
+      double num = (i < y.size()) ? y[i] : x[i - y.size()];
+      const std::vector<TextStyle> &styles = (i < y.size()) ? yStyles : xStyles;
+      unsigned index = (i < y.size()) ? i : i - y.size();
+      const TextStyle &style = (index < styles.size()) ? styles[index] : defaultTextStyle;
+
+      // old boxes are sorted the same way, vertical first,
+      // so the one with the same value is found in one pass
+      while((old < textBoxes.size()) &&
+            (((textBoxes[old].ar == vertical) && (ar == horizontal)) ||
+             ((textBoxes[old].ar == ar) && (textBoxes[old].num < num))))
+        old++;
+
+      if((old < textBoxes.size()) && (textBoxes[old].ar == ar) && (textBoxes[old].num == num) &&
+         (textBoxes[old].style == style))
+        {
+          boxes[i].print.swap(textBoxes[old].print);
+          boxes[i].printInfo.swap(textBoxes[old].printInfo);
+          boxes[i].pos.swap(textBoxes[old].pos);
+          boxes[i].num = num;
+          boxes[i].ar = ar;
+          boxes[i].style = style;
+          boxes[i].width = textBoxes[old].width;
+          boxes[i].height = textBoxes[old].height;
+          boxes[i].placed = textBoxes[old].placed;
+          old++;
+        }
+      else
+        {
+          if((old < textBoxes.size()) && (textBoxes[old].ar == ar) && (textBoxes[old].num == num))
+            old++;
+          createText(boxes[i], num, ar, style);
+          changed[ar] = true;
+        }
+    }
+
+  textBoxes.swap(boxes);
+
+  if((old_count[vertical] != y.size()) || changed[vertical])
+    version[vertical]++;
+  if((old_count[horizontal] != x.size()) || changed[horizontal])
+    version[horizontal]++;
+}
+
+
+/*!
+ * \brief TextLayout::createText
+ * \param box text to fill
+ * \param num value to print
+ * \param ar arrange of text
+ * \param style color and emphasis of text
+ *
+ * Slice \param num into characters and
+ * find glyph params for each of them.
+ */
+void TextLayout::createText(Text &box, double num, Arrange ar, const TextStyle &style)
+{
+  TRACE_ZONE("glyph lookup");
+  box.num = num;
+  getCharFromFloat(&box.print, num);
+  box.printInfo.resize(box.print.size());
+  box.ar = ar;
+  box.style = style;
+  box.pos.resize(box.print.size() * 6);
+  box.width = box.print.size() * characterWidth;
+  box.height = characterHeight;
+  box.placed = false;
+
+  for(unsigned j = 0; j < box.print.size(); j++)
+    {
+      const Character &character = Characters.at(box.print[j]);
+      box.printInfo[j].Advance = style.bold ? character.BoldAdvance : character.Advance;
+      box.printInfo[j].Bearing = style.bold ? character.BoldBearingX : character.BearingX;
+      box.printInfo[j].texX = character.texX;
+    }
+}
+
+
+/*!
+ * \brief TextLayout::updateTextPositions
+ *
+ * Update positions of text of screen.
+ *
+ * Call after resize events and \fn setText() calls.
+ * Text that was laid out for the same pixel size and
+ * the same axis edge is not touched, so scrolling
+ * lays out only new labels of the scrolled axis.
+ * Pixel positions of horizontal labels move with the
+ * left edge and vertical ones with the bottom edge,
+ * versions of layers are changed when they do.
+ * Remember, we use triangles to render textures from texture atlas.
+ * Every glyph is 6 \struct GlyphVertex, with style of its label
+ * Screen coords:
+ * 0---*    3---5
+ * | \ |    | \ |
+ * 1---2    *---4
+ * Texture coords:
+ * 1---2    *---4
+ * | / |    | / |
+ * 0---*    3---5
+ */
+void TextLayout::updateTextPositions()
+{
+  TRACE_ZONE("layout");
+  double xpos = 0;
+  double ypos = 0;
+  double x_pen = 0;
+  double xpos_hinted = 0;
+  double ypos_hinted = 0;
+  double tex_pos_x = 0;
+  double char_width = quadWidth * pixelWidth;
+  double char_height = characterHeight * pixelHeight;
+  double device_width = pixelWidth / deviceScale;
+  double device_height = pixelHeight / deviceScale;
+
+  bool same_scale = (fabs(pixelWidth - placedPixelWidth) <= pixelWidth * 1e-6) &&
+                    (fabs(pixelHeight - placedPixelHeight) <= pixelHeight * 1e-6);
+  bool same_bottom = same_scale && (proj.bottom == placedProj.bottom);
+  bool same_left = same_scale && (proj.left == placedProj.left);
+
+  if(!same_left)
+    version[horizontal]++;
+  if(!same_bottom)
+    version[vertical]++;
+
+  for(unsigned i = 0; i < textBoxes.size(); i++ )
+    {
+      if(textBoxes[i].placed && ((textBoxes[i].ar == horizontal) ? same_bottom : same_left))
+        continue;
+
+      if(textBoxes[i].ar == horizontal)
+        {
+          xpos = textBoxes[i].num - (textBoxes[i].width * pixelWidth / 2);
+          ypos = proj.bottom + (pixelHeight * 1);
+        }
+      if(textBoxes[i].ar == vertical)
+        {
+          xpos = proj.left + (pixelWidth * 4);
+          ypos = textBoxes[i].num - (char_height / 2);
+        }
+
+      // every glyph starts at whole device pixel, so texels of atlas map to them one to one
+      x_pen = hintToPixel(xpos, pixelWidth);
+      ypos_hinted = hintToPixel(ypos, device_height);
+      const TextStyle &style = textBoxes[i].style;
+      for (unsigned j = 0; j < textBoxes[i].printInfo.size(); j++)
+        {
+          xpos_hinted = hintToPixel(x_pen + ( textBoxes[i].printInfo[j].Bearing * pixelWidth ), device_width);
+          tex_pos_x = textBoxes[i].printInfo[j].texX;
+          setQuad(&textBoxes[i].pos[j * 6], xpos_hinted, ypos_hinted, char_width, quadHeight * pixelHeight,
+                  tex_pos_x, style);
+
+          x_pen += textBoxes[i].printInfo[j].Advance * pixelWidth;
+        }
+      textBoxes[i].placed = true;
+    }
+
+  if(updateAreaPixels())
+    {
+      version[horizontal]++;
+      version[vertical]++;
+    }
+  placeChrome(vertical);
+  placeChrome(horizontal);
+
+  placedProj = proj;
+  placedPixelWidth = pixelWidth;
+  placedPixelHeight = pixelHeight;
+}
+
+
+/*!
+ * \brief TextLayout::updateAreaPixels
+ * \return true if edges of plot area moved in pixels since the last placement
+ *
+ * Chrome of both layers is placed relative to plot area,
+ * so it moves in pixels when reserved space for text
+ * changes, not only with the edges of projection matrix.
+ */
+bool TextLayout::updateAreaPixels()
+{
+  long pixels[4] = {
+    lround((hintToPixel(plotArea.left, pixelWidth) - proj.left) / pixelWidth),
+    lround((hintToPixel(plotArea.right, pixelWidth) - proj.left) / pixelWidth),
+    lround((hintToPixel(plotArea.bottom, pixelHeight) - proj.bottom) / pixelHeight),
+    lround((hintToPixel(plotArea.top, pixelHeight) - proj.bottom) / pixelHeight)
+  };
+
+  bool changed = false;
+  for(int i = 0; i < 4; i++)
+    {
+      changed = changed || (pixels[i] != areaPixels[i]);
+      areaPixels[i] = pixels[i];
+    }
+  return changed;
+}
+
+
+/*!
+ * \brief TextLayout::placeChrome
+ * \param ar axis to place ticks and grid lines of
+ *
+ * Every label of the axis inside plot area gets a grid line
+ * across the area and a tick of TICK_LENGTH pixels at its
+ * edge, so chrome follows the same positions labels do.
+ * Frame around the area goes with vertical axis, its pixel
+ * positions don't change when horizontal one scrolls.
+ * Lines are one pixel wide and hinted, so they stay sharp.
+ * Chrome is a few quads per label, it's placed again on
+ * every call.
+ */
+void TextLayout::placeChrome(Arrange ar)
+{
+  chrome[ar].clear();
+  if((plotArea.right <= plotArea.left) || (plotArea.top <= plotArea.bottom) ||
+     (pixelWidth <= 0) || (pixelHeight <= 0))
+    return;
+
+  double left = hintToPixel(plotArea.left, pixelWidth);
+  double right = hintToPixel(plotArea.right, pixelWidth);
+  double bottom = hintToPixel(plotArea.bottom, pixelHeight);
+  double top = hintToPixel(plotArea.top, pixelHeight);
+
+  for(unsigned i = 0; i < textBoxes.size(); i++)
+    {
+      if(textBoxes[i].ar != ar)
+        continue;
+
+      if(ar == vertical)
+        {
+          double y = hintToPixel(textBoxes[i].num, pixelHeight);
+          if((y < bottom) || (y >= top))
+            continue;
+          addSolidQuad(chrome[ar], left, y, right - left, pixelHeight, gridStyle);
+          addSolidQuad(chrome[ar], left, y, TICK_LENGTH * pixelWidth, pixelHeight, defaultTextStyle);
+        }
+      else
+        {
+          double x = hintToPixel(textBoxes[i].num, pixelWidth);
+          if((x < left) || (x >= right))
+            continue;
+          addSolidQuad(chrome[ar], x, bottom, pixelWidth, top - bottom, gridStyle);
+          addSolidQuad(chrome[ar], x, bottom, pixelWidth, TICK_LENGTH * pixelHeight, defaultTextStyle);
+        }
+    }
+
+  if(ar == vertical)
+    {
+      addSolidQuad(chrome[ar], left, bottom, pixelWidth, top - bottom, defaultTextStyle);
+      addSolidQuad(chrome[ar], right - pixelWidth, bottom, pixelWidth, top - bottom, defaultTextStyle);
+      addSolidQuad(chrome[ar], left, bottom, right - left, pixelHeight, defaultTextStyle);
+      addSolidQuad(chrome[ar], left, top - pixelHeight, right - left, pixelHeight, defaultTextStyle);
+    }
+}
+
+
+/*!
+ * \brief TextLayout::buildFrame
+ * \param frame staging buffer to fill
+ *
+ * Pack glyph quads of all boxes and chrome of their
+ * axes to one vertex stream, vertical layer first,
+ * and remember range and version of each layer.
+ */
+void TextLayout::buildFrame(TextFrame &frame)
+{
+  TRACE_ZONE("build frame");
+  size_t size = chrome[horizontal].size() + chrome[vertical].size();
+  for(unsigned i = 0; i < textBoxes.size(); i++)
+    size += textBoxes[i].pos.size();
+
+  frame.vertices.resize(size);
+
+  size_t offset = 0;
+  const Arrange order[2] = { vertical, horizontal };
+  for(int layer = 0; layer < 2; layer++)
+    {
+      Arrange ar = order[layer];
+      frame.first[ar] = offset;
+      for(unsigned i = 0; i < textBoxes.size(); i++)
+        {
+          if(textBoxes[i].ar != ar)
+            continue;
+          std::copy(textBoxes[i].pos.begin(), textBoxes[i].pos.end(), frame.vertices.begin() + offset);
+          offset += textBoxes[i].pos.size();
+        }
+      std::copy(chrome[ar].begin(), chrome[ar].end(), frame.vertices.begin() + offset);
+      offset += chrome[ar].size();
+      frame.count[ar] = offset - frame.first[ar];
+    }
+  frame.version[horizontal] = version[horizontal];
+  frame.version[vertical] = version[vertical];
+  frame.proj = proj;
+  frame.originX = originX;
+  frame.originY = originY;
+}
+
+
+/*!
+ * \brief TextLayout::memoryBytes
+ * \return bytes held by glyph metrics, labels and chrome
+ *
+ * Capacities are counted, not sizes, nodes of glyph
+ * metrics are estimated without allocator overhead.
+ */
+size_t TextLayout::memoryBytes() const
+{
+  size_t bytes = Characters.bucket_count() * sizeof(void *) +
+                 Characters.size() * (sizeof(std::pair<const char, Character>) + sizeof(void *));
+  bytes += textBoxes.capacity() * sizeof(Text);
+  for(size_t i = 0; i < textBoxes.size(); i++)
+    bytes += textBoxes[i].print.capacity() + textBoxes[i].printInfo.capacity() * sizeof(CHPrintInfo) +
+             textBoxes[i].pos.capacity() * sizeof(GlyphVertex);
+  bytes += (chrome[horizontal].capacity() + chrome[vertical].capacity()) * sizeof(GlyphVertex);
+  return bytes;
+}
+
+
+/*!
+ * \brief TextLayout::compact
+ *
+ * Release capacity labels and chrome don't use,
+ * e.g. after axis showed many more labels than now.
+ * Layout stays as it is.
+ */
+void TextLayout::compact()
+{
+  std::vector<Text>(textBoxes).swap(textBoxes);
+  std::vector<GlyphVertex>(chrome[horizontal]).swap(chrome[horizontal]);
+  std::vector<GlyphVertex>(chrome[vertical]).swap(chrome[vertical]);
+}
+
+
+/*!
+ * \brief TextLayout::measureString
+ * \param text characters to print, ones missing in atlas are skipped
+ * \param style emphasis selects metrics
+ * \return width of printed \param text in pixels, sum of advances
+ */
+int TextLayout::measureString(const std::string &text, const TextStyle &style)
+{
+  int width = 0;
+  for(size_t i = 0; i < text.size(); i++)
+    {
+      std::unordered_map<char, Character>::const_iterator it = Characters.find(text[i]);
+      if(it != Characters.end())
+        width += style.bold ? it->second.BoldAdvance : it->second.Advance;
+    }
+  return width;
+}
+
+
+/*!
+ * \brief TextLayout::placeString
+ * \param text characters to print, ones missing in atlas are skipped
+ * \param x left edge of text in values of projection matrix
+ * \param y bottom edge of text
+ * \param style color and emphasis of text
+ * \param out 6 vertices per glyph are written here
+ * \param maxGlyphs glyphs that fit to \param out, the rest are cut
+ * \return number of glyphs written
+ *
+ * Lay out one line of text with the pixel sizes of
+ * the last \fn setView(), the same way labels of
+ * axes are, so it's hinted to pixels.
+ */
+size_t TextLayout::placeString(const std::string &text, double x, double y, const TextStyle &style,
+                               GlyphVertex *out, size_t maxGlyphs)
+{
+  TRACE_ZONE("glyph lookup");
+  double char_width = quadWidth * pixelWidth;
+  double char_height = quadHeight * pixelHeight;
+  double device_width = pixelWidth / deviceScale;
+  double x_hinted = hintToPixel(x, pixelWidth);
+  double y_hinted = hintToPixel(y, pixelHeight / deviceScale);
+
+  size_t glyphs = 0;
+  for(size_t i = 0; (i < text.size()) && (glyphs < maxGlyphs); i++)
+    {
+      std::unordered_map<char, Character>::const_iterator it = Characters.find(text[i]);
+      if(it == Characters.end())
+        continue;
+
+      const Character &character = it->second;
+      double xpos = hintToPixel(x_hinted + (style.bold ? character.BoldBearingX : character.BearingX) * pixelWidth,
+                                device_width);
+      double tex_pos_x = character.texX;
+      setQuad(out + glyphs * 6, xpos, y_hinted, char_width, char_height, tex_pos_x, style);
+
+      x_hinted += (style.bold ? character.BoldAdvance : character.Advance) * pixelWidth;
+      glyphs++;
+    }
+  return glyphs;
+}
+
+
+/*!
+ * \brief TextLayout::placeString
+ * \param text characters to print, ones missing in atlas are skipped
+ * \param x anchor of text in values of projection matrix
+ * \param y
+ * \param style color and emphasis of text
+ * \param anchor rotation of text and its point put at anchor
+ * \param out 6 vertices per glyph are written here
+ * \param maxGlyphs glyphs that fit to \param out, the rest are cut
+ * \return number of glyphs written
+ *
+ * All vertices of text hold its anchor, and corners of
+ * glyphs are whole device pixel offsets from it, which
+ * shader rotates. So rotated text is drawn from the same atlas,
+ * by the same program and in the same batch as the rest,
+ * and nothing is rasterized again for another angle.
+ * Default anchor lays out text the same way as the
+ * overload without it.
+ */
+size_t TextLayout::placeString(const std::string &text, double x, double y, const TextStyle &style,
+                               const TextAnchor &anchor, GlyphVertex *out, size_t maxGlyphs)
+{
+  if(anchor == defaultAnchor)
+    return placeString(text, x, y, style, out, maxGlyphs);
+
+  TRACE_ZONE("glyph lookup");
+  double x_hinted = hintToPixel(x, pixelWidth / deviceScale);
+  double y_hinted = hintToPixel(y, pixelHeight / deviceScale);
+  int width = measureString(text, style);
+  // alignment is rounded once in device pixels, half a logical pixel
+  // of centered text is a whole device pixel at scale 2
+  int shift = static_cast<int>(lround(-(width * anchor.alignX) / 2.0 * deviceScale));
+  int bottom = static_cast<int>(lround(-(characterHeight * anchor.alignY) / 2.0 * deviceScale));
+  int pen = 0;
+  int texels_x = cellTexels(cellWidth, deviceScale);
+  int texels_y = cellTexels(characterHeight, deviceScale);
+
+  double turns = anchor.angle / 360.0;
+  turns -= floor(turns);
+  unsigned short angle = static_cast<unsigned short>(static_cast<long>(turns * 65536.0 + 0.5) & 0xFFFF);
+
+  size_t glyphs = 0;
+  for(size_t i = 0; (i < text.size()) && (glyphs < maxGlyphs); i++)
+    {
+      std::unordered_map<char, Character>::const_iterator it = Characters.find(text[i]);
+      if(it == Characters.end())
+        continue;
+
+      const Character &character = it->second;
+      int left = shift + static_cast<int>(lround((pen + (style.bold ? character.BoldBearingX : character.BearingX)) * deviceScale));
+      GlyphVertex *quad = out + glyphs * 6;
+      setQuad(quad, x_hinted, y_hinted, 0, 0, character.texX, style);
+
+      // corners in the order of \fn setQuad(), in device pixels
+      const int dx[6] = { 0, 0, texels_x, 0, texels_x, texels_x };
+      const int dy[6] = { texels_y, 0, 0, texels_y, 0, texels_y };
+      for(int v = 0; v < 6; v++)
+        {
+          quad[v].dx = static_cast<short>(left + dx[v]);
+          quad[v].dy = static_cast<short>(bottom + dy[v]);
+          quad[v].angle = angle;
+        }
+
+      pen += style.bold ? character.BoldAdvance : character.Advance;
+      glyphs++;
+    }
+  return glyphs;
+}
@@ -0,0 +1,190 @@
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "layouttypes.h"
+
+#define MAX_CH 7      ///< Most characters printed for fraction part of label
+#define TICK_LENGTH 4 ///< Length of tick marks in pixels, pointed into plot area
+
+
+struct TextStyle
+{
+  unsigned char color[4]; ///< RGBA of label, alpha is its opacity
+  unsigned char bold;     ///< 1 to print from bold layer of texture atlas
+};
+
+
+inline bool operator==(const TextStyle &a, const TextStyle &b)
+{
+  return (a.color[0] == b.color[0]) && (a.color[1] == b.color[1]) &&
+         (a.color[2] == b.color[2]) && (a.color[3] == b.color[3]) && (a.bold == b.bold);
+}
+
+
+inline bool operator!=(const TextStyle &a, const TextStyle &b)
+{
+  return !(a == b);
+}
+
+
+enum TextAlign
+{
+  alignStart,             ///< Left or bottom edge of text is at anchor
+  alignCenter,
+  alignEnd                ///< Right or top edge of text is at anchor
+};
+
+
+struct TextAnchor
+{
+  float angle;            ///< Rotation of text around anchor, degrees counterclockwise
+  TextAlign alignX;       ///< Point of text put at anchor, before it's rotated
+  TextAlign alignY;
+};
+
+
+inline bool operator==(const TextAnchor &a, const TextAnchor &b)
+{
+  return (a.angle == b.angle) && (a.alignX == b.alignX) && (a.alignY == b.alignY);
+}
+
+
+inline bool operator!=(const TextAnchor &a, const TextAnchor &b)
+{
+  return !(a == b);
+}
+
+
+extern const TextStyle defaultTextStyle;
+extern const TextStyle gridStyle;
+extern const TextAnchor defaultAnchor;
+
+
+struct GlyphVertex
+{
+  float x;                ///< Position in values of projection matrix relative to origin, anchor of rotated text
+  float y;
+  float s;                ///< Position in texture atlas
+  float t;
+  short dx;               ///< Offset from anchor in device pixels, rotated by \var angle in shader, 0 for unrotated text
+  short dy;
+  unsigned char color[4]; ///< RGBA of label, normalized in shader
+  unsigned char layer;    ///< Layer of texture atlas, 0 regular, 1 bold
+  unsigned char padding;
+  unsigned short angle;   ///< Rotation of offset counterclockwise, 65536 is full turn
+};
+
+
+struct TextFrame
+{
+  std::vector<GlyphVertex> vertices;   ///< Glyph quads of all labels and chrome, vertical layer first
+  int first[2];           ///< First vertex of each layer, indexed by \enum TextLayout::Arrange
+  int count[2];           ///< Number of vertices of each layer
+  unsigned version[2];    ///< Changes every time labels or pixel positions of layer change
+  Proj proj;              ///< Projection matrix values frame was laid out for
+  double originX;         ///< Position vertices are relative to, see \fn TextLayout::setOrigin()
+  double originY;
+  size_t layoutBytes;     ///< Memory of layout that built frame and of its frames, see \fn FrameBuilder::run()
+};
+
+
+class TextLayout
+{
+
+public:
+  enum Arrange
+  {
+    horizontal,
+    vertical
+  };
+
+private:
+  struct CHPrintInfo
+  {
+    unsigned Bearing;
+    unsigned Advance;
+    double texX;
+    double texY;
+  };
+
+  struct Text
+  {
+    double num;
+    std::vector<char> print;
+    std::vector<CHPrintInfo>printInfo;
+    std::vector<GlyphVertex> pos;
+    TextStyle style;
+    Arrange ar;
+    double width;
+    double height;
+    bool placed;          ///< \var pos is up to date with the last layout
+  };
+
+public:
+  explicit TextLayout();
+  ~TextLayout();
+
+  void setGlyphs(const std::unordered_map<char, Character> &chars, int width, int height, double factor);
+  void setText(const std::vector<double> &y, const std::vector<double> &x,
+               const std::vector<TextStyle> &yStyles, const std::vector<TextStyle> &xStyles);
+  void setView(const Proj &pr, double pxWidth, double pxHeight);
+  void setOrigin(double x, double y);
+  void setDeviceScale(double scale);
+  void setPlotArea(const Proj &area);
+  void updateTextPositions();
+  void buildFrame(TextFrame &frame);
+  size_t memoryBytes() const;
+  void compact();
+
+  int measureString(const std::string &text, const TextStyle &style);
+  size_t placeString(const std::string &text, double x, double y, const TextStyle &style,
+                     GlyphVertex *out, size_t maxGlyphs);
+  size_t placeString(const std::string &text, double x, double y, const TextStyle &style,
+                     const TextAnchor &anchor, GlyphVertex *out, size_t maxGlyphs);
+
+  static void getCharFromFloat(std::vector<char> *number, double input);
+  static double hintToPixel(double num, double pixelsize);
+  static int cellTexels(int pixels, double scale);
+  static void setVertex(GlyphVertex &vertex, double x, double y, double s, double t, const TextStyle &style);
+
+private:
+  void createText(Text &box, double num, Arrange ar, const TextStyle &style);
+  void setQuad(GlyphVertex *quad, double x, double y, double width, double height,
+               double texX, const TextStyle &style);
+  void addSolidQuad(std::vector<GlyphVertex> &out, double x, double y, double width, double height,
+                    const TextStyle &style);
+  void placeChrome(Arrange ar);
+  bool updateAreaPixels();
+  void updateQuadSize();
+
+  std::unordered_map<char, Character> Characters;  ///< Copy of glyph metrics, layout doesn't touch shared ones
+  int characterWidth;      ///< Advance of digit, labels of axes are measured with it
+  int cellWidth;           ///< Width of glyph cell in logical pixels
+  int characterHeight;
+  double colFactor;        ///< Width of one glyph in texture atlas
+  double deviceScale;      ///< Device pixel ratio, glyphs are hinted to device pixels
+  double quadWidth;        ///< Size of glyph quad in logical pixels, cell of atlas in texels over \var deviceScale
+  double quadHeight;
+
+  std::vector<Text> textBoxes;
+  std::vector<GlyphVertex> chrome[2];   ///< Ticks and grid lines of each axis, frame is in vertical one
+  unsigned version[2];     ///< Versions of layers, see \struct TextFrame
+
+  Proj proj;               ///< Holds projection matrix values
+  double pixelWidth;
+  double pixelHeight;
+  Proj placedProj;         ///< Projection matrix values text was laid out for
+  double placedPixelWidth;
+  double placedPixelHeight;
+  Proj plotArea;           ///< Part of widget data is drawn in, framed by chrome
+  double originX;          ///< Position subtracted from vertices, so floats keep whole pixels far from zero
+  double originY;
+  long areaPixels[4];      ///< Edges of \var plotArea in pixels from the bottom left corner, as last placed
+};
+
+
+#endif // TEXTLAYOUT_H
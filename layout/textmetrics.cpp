@@ -0,0 +1,124 @@
+#include "textmetrics.h"
+#include "textlayout.h"
+
+
+TextMetrics::TextMetrics()
+{
+  proj.left = 0;
+  proj.right = 0;
+  proj.bottom = 0;
+  proj.top = 0;
+  pixelWidth = 0;
+  pixelHeight = 0;
+  textMaxWidth = 0;
+  textHeight = 0;
+  characterWidth = 0;
+  characterHeight = 0;
+}
+
+
+TextMetrics::~TextMetrics()
+{
+
+}
+
+
+/*!
+ * \brief TextMetrics::setCharacterSize
+ * \param width advance of digit in pixels
+ * \param height height of glyph cell in pixels
+ *
+ * Taken from glyph metrics of atlas, labels
+ * of axes are measured with them.
+ */
+void TextMetrics::setCharacterSize(int width, int height)
+{
+  characterWidth = width;
+  characterHeight = height;
+}
+
+
+/*!
+ * \brief TextMetrics::setProjMatrix
+ * \param pr projection matrix values
+ *
+ * After that, \fn reserveSpace() should be called
+ * to reserve enough space in parent widget, so
+ * text isn't printed over values.
+ */
+void TextMetrics::setProjMatrix(const Proj &pr)
+{
+  proj = pr;
+}
+
+
+/*!
+ * \brief TextMetrics::reserveSpace
+ * \param width of widget in pixels
+ * \param height of widget in pixels
+ *
+ * Widen projection matrix, so labels are printed in the
+ * left and bottom part of widget, and snap its edges to
+ * whole pixels, so text won't look fuzzy.
+ */
+void TextMetrics::reserveSpace(int width, int height)
+{
+  // example value to test reserving enough space for text
+  int pix_x_offs = textMaxWidth + characterWidth;  // text width * number of characters + offset
+  int pix_y_offs = textHeight + 2;       // text height + offset
+
+  double del_w = pix_x_offs * pixelWidth / static_cast<double>(width);                  // how much pixel size will change after reserving space for text
+  double del_h = pix_y_offs * pixelHeight / static_cast<double>(height);
+
+  proj.left -= (pixelWidth + del_w) * pix_x_offs;                         // reserve enough space for text texture
+  proj.bottom -= (pixelHeight + del_h) * pix_y_offs;
+  proj.right += pixelWidth * 10;
+  proj.top += pixelHeight * (textHeight / 2);
+
+  pixelWidth = (proj.right - proj.left) / static_cast<double>(width);    // recalculate pixel sizes
+  pixelHeight = (proj.top - proj.bottom) / static_cast<double>(height);
+
+  proj.left = TextLayout::hintToPixel(proj.left, pixelWidth);          // due to sublixel text interpolation, we need to make projection matrix
+  proj.right = TextLayout::hintToPixel(proj.right, pixelWidth);        // to be equal to integer number in pixels
+  proj.bottom = TextLayout::hintToPixel(proj.bottom, pixelHeight);
+  proj.top = TextLayout::hintToPixel(proj.top, pixelHeight);
+}
+
+
+/*!
+ * \brief TextMetrics::measureText
+ * \param num value to measure
+ * \return width of printed \param num in pixels
+ *
+ * Slice value the same way labels are sliced,
+ * but don't store it anywhere.
+ */
+int TextMetrics::measureText(double num) const
+{
+  std::vector<char> print;
+  TextLayout::getCharFromFloat(&print, num);
+  return print.size() * characterWidth;
+}
+
+
+/*!
+ * \brief TextMetrics::measureLabels
+ * \param y values to print on the left axis
+ *
+ * Only width of the widest label is kept,
+ * so space for text can be reserved.
+ */
+void TextMetrics::measureLabels(const std::vector<double> &y)
+{
+  textMaxWidth = 0;
+  textHeight = characterHeight;
+
+  for(size_t i = 0; i < y.size(); i++)
+    {
+      int width = measureText(y[i]);
+      if(width > textMaxWidth)
+        {
+          textMaxWidth = width;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef TEXTMETRICS_H
+#define TEXTMETRICS_H
+
+#include <vector>
+
+#include "layouttypes.h"
+
+
+class TextMetrics
+{
+
+public:
+  explicit TextMetrics();
+  ~TextMetrics();
+
+  void setCharacterSize(int width, int height);
+  void setProjMatrix(const Proj &pr);
+  void reserveSpace(int width, int height);
+
+  int measureText(double num) const;
+  void measureLabels(const std::vector<double> &y);
+
+  inline void setPixelHeight(double height);
+  inline void setPixelWidth(double width);
+
+  inline const Proj &getProjMatrix() const;
+  inline double getPixelHeight() const;
+  inline double getPixelWidth() const;
+  inline int getCharacterWidth() const;
+  inline int getCharacterHeight() const;
+  inline int getTextMaxWidth() const;
+
+private:
+  Proj proj;               ///< Holds projection matrix values
+  double pixelWidth;
+  double pixelHeight;
+  int textMaxWidth;        ///< Widest label of the left axis in pixels
+  int textHeight;
+  int characterWidth;      ///< Advance of digit, labels are measured with it
+  int characterHeight;
+};
+
+
+inline void TextMetrics::setPixelHeight(double height)
+{
+  pixelHeight = height;
+}
+
+
+inline void TextMetrics::setPixelWidth(double width)
+{
+  pixelWidth = width;
+}
+
+
+inline const Proj &TextMetrics::getProjMatrix() const
+{
+  return proj;
+}
+
+
+inline double TextMetrics::getPixelHeight() const
+{
+  return pixelHeight;
+}
+
+
+inline double TextMetrics::getPixelWidth() const
+{
+  return pixelWidth;
+}
+
+
+inline int TextMetrics::getCharacterWidth() const
+{
+  return characterWidth;
+}
+
+
+inline int TextMetrics::getCharacterHeight() const
+{
+  return characterHeight;
+}
+
+
+inline int TextMetrics::getTextMaxWidth() const
+{
+  return textMaxWidth;
+}
+
+
+#endif // TEXTMETRICS_H
@@ -0,0 +1,200 @@
+#include "tracezones.h"
+#include <stdio.h>
+#include <chrono>
+#include <mutex>
+
+
+std::atomic<bool> TraceZones::recording(false);
+std::vector<std::unique_ptr<ZoneTrack> > TraceZones::tracks;
+
+static std::mutex tracksLock;   ///< Guards \var TraceZones::tracks, taken once per thread and on export
+static thread_local ZoneTrack *currentTrack = nullptr;
+static ZoneTrack *gpuTrack = nullptr;
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+
+/*!
+ * \brief TraceZones::start
+ *
+ * Record zones of all threads from now on. Zones
+ * compiled without PLOT_TRACE_ZONES are not recorded.
+ */
+void TraceZones::start()
+{
+  recording = true;
+}
+
+
+/*!
+ * \brief TraceZones::stop
+ *
+ * Zones already recorded are kept for \fn exportJson().
+ */
+void TraceZones::stop()
+{
+  recording = false;
+}
+
+
+/*!
+ * \brief TraceZones::now
+ * \return nanoseconds of steady clock since process started
+ */
+uint64_t TraceZones::now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+
+/*!
+ * \brief TraceZones::record
+ * \param name zone name, string literal
+ * \param begin from \fn now()
+ * \param end from \fn now()
+ *
+ * Appended to track of the calling thread. Only that thread
+ * writes to it and export reads only published events, so
+ * recording takes no lock. Track is created on the first
+ * event of thread.
+ */
+void TraceZones::record(const char *name, uint64_t begin, uint64_t end)
+{
+  append(threadTrack(), name, begin, end);
+}
+
+
+/*!
+ * \brief TraceZones::recordGpu
+ * \param name zone name, string literal
+ * \param begin GPU timestamp moved to \fn now() clock
+ * \param end GPU timestamp moved to \fn now() clock
+ *
+ * Appended to GPU track. Should be called from GUI
+ * thread only, that's where contexts are current.
+ */
+void TraceZones::recordGpu(const char *name, uint64_t begin, uint64_t end)
+{
+  if(gpuTrack == nullptr)
+    gpuTrack = addTrack("GPU");
+  append(gpuTrack, name, begin, end);
+}
+
+
+/*!
+ * \brief TraceZones::nameThread
+ * \param name shown for track of the calling thread
+ */
+void TraceZones::nameThread(const std::string &name)
+{
+  ZoneTrack *track = threadTrack();
+  std::lock_guard<std::mutex> guard(tracksLock);
+  track->name = name;
+}
+
+
+/*!
+ * \brief TraceZones::threadTrack
+ * \return track of the calling thread
+ */
+ZoneTrack *TraceZones::threadTrack()
+{
+  if(currentTrack == nullptr)
+    currentTrack = addTrack(std::string());
+  return currentTrack;
+}
+
+
+/*!
+ * \brief TraceZones::addTrack
+ * \param name shown for track, empty for "thread <id>"
+ * \return new track, kept until process ends
+ *
+ * Events aren't allocated here, threads that record
+ * a few zones or only name themselves stay small.
+ */
+ZoneTrack *TraceZones::addTrack(const std::string &name)
+{
+  std::unique_ptr<ZoneTrack> track(new ZoneTrack());
+  track->count = 0;
+  track->dropped = 0;
+
+  std::lock_guard<std::mutex> guard(tracksLock);
+  track->id = tracks.size() + 1;
+  track->name = name.empty() ? "thread " + std::to_string(track->id) : name;
+  tracks.push_back(std::move(track));
+  return tracks.back().get();
+}
+
+
+/*!
+ * \brief TraceZones::append
+ * \param track written only by the calling thread
+ * \param name zone name
+ * \param begin
+ * \param end
+ *
+ * Event and its block are filled before count is
+ * published, so export never reads a half written one.
+ */
+void TraceZones::append(ZoneTrack *track, const char *name, uint64_t begin, uint64_t end)
+{
+  size_t index = track->count.load(std::memory_order_relaxed);
+  if(index >= TRACE_ZONE_EVENTS)
+    {
+      track->dropped.fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+
+  std::unique_ptr<ZoneEvent[]> &block = track->blocks[index / TRACE_ZONE_BLOCK];
+  if(!block)
+    block.reset(new ZoneEvent[TRACE_ZONE_BLOCK]);
+  ZoneEvent &event = block[index % TRACE_ZONE_BLOCK];
+  event.name = name;
+  event.begin = begin;
+  event.end = end;
+  track->count.store(index + 1, std::memory_order_release);
+}
+
+
+/*!
+ * \brief TraceZones::exportJson
+ * \param path file to write, replaced if it exists
+ * \return false if file can't be written
+ *
+ * Write zones recorded so far as Chrome trace event JSON,
+ * one complete event per zone and one named track per
+ * thread, GPU zones on a track of their own. Opens in
+ * chrome://tracing and ui.perfetto.dev. Can be called
+ * while zones are recorded.
+ */
+bool TraceZones::exportJson(const std::string &path)
+{
+  FILE *file = fopen(path.c_str(), "w");
+  if(file == nullptr)
+    return false;
+
+  std::lock_guard<std::mutex> guard(tracksLock);
+  fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  fprintf(file, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"plot\"}}");
+
+  size_t dropped = 0;
+  for(size_t t = 0; t < tracks.size(); t++)
+    {
+      const ZoneTrack &track = *tracks[t];
+      fprintf(file, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+              track.id, track.name.c_str());
+
+      size_t count = track.count.load(std::memory_order_acquire);
+      for(size_t i = 0; i < count; i++)
+        {
+          const ZoneEvent &event = track.blocks[i / TRACE_ZONE_BLOCK][i % TRACE_ZONE_BLOCK];
+          fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                  event.name, track.id, event.begin / 1e3,
+                  (event.end > event.begin) ? (event.end - event.begin) / 1e3 : 0.0);
+        }
+      dropped += track.dropped.load(std::memory_order_relaxed);
+    }
+
+  fprintf(file, "\n],\"otherData\":{\"dropped\":%zu}}\n", dropped);
+  return fclose(file) == 0;
+}
@@ -0,0 +1,117 @@
+#ifndef TRACEZONES_H
+#define TRACEZONES_H
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <stdint.h>
+#include <stddef.h>
+
+#define TRACE_ZONE_EVENTS 65536   ///< Events kept per thread, later ones are dropped
+#define TRACE_ZONE_BLOCK 1024     ///< Events allocated at once, track grows by blocks as thread records
+
+
+/*!
+ * Scoped zones are compiled only with PLOT_TRACE_ZONES
+ * defined, see option of the same name in CMakeLists.txt.
+ * Without it TRACE_ZONE() and TRACE_THREAD() expand to
+ * nothing.
+ */
+#ifdef PLOT_TRACE_ZONES
+#define TRACE_ZONE_JOIN2(a, b) a##b
+#define TRACE_ZONE_JOIN(a, b) TRACE_ZONE_JOIN2(a, b)
+#define TRACE_ZONE(name) TraceZone TRACE_ZONE_JOIN(traceZone, __LINE__)(name)
+#define TRACE_THREAD(name) TraceZones::nameThread(name)
+#else
+#define TRACE_ZONE(name)
+#define TRACE_THREAD(name)
+#endif
+
+
+struct ZoneEvent
+{
+  const char *name;       ///< String literal, only the pointer is kept
+  uint64_t begin;         ///< Nanoseconds since process started, see \fn TraceZones::now()
+  uint64_t end;
+};
+
+
+struct ZoneTrack
+{
+  std::unique_ptr<ZoneEvent[]> blocks[TRACE_ZONE_EVENTS / TRACE_ZONE_BLOCK];   ///< Allocated on first event of block, filled up to \var count
+  std::atomic<size_t> count;       ///< Events published to \fn TraceZones::exportJson()
+  std::atomic<size_t> dropped;     ///< Events that didn't fit
+  std::string name;
+  int id;                 ///< Thread id of track in exported trace
+};
+
+
+class TraceZones
+{
+
+public:
+  static void start();
+  static void stop();
+  static inline bool active();
+
+  static uint64_t now();
+  static void record(const char *name, uint64_t begin, uint64_t end);
+  static void recordGpu(const char *name, uint64_t begin, uint64_t end);
+  static void nameThread(const std::string &name);
+
+  static bool exportJson(const std::string &path);
+
+private:
+  static ZoneTrack *threadTrack();
+  static ZoneTrack *addTrack(const std::string &name);
+  static void append(ZoneTrack *track, const char *name, uint64_t begin, uint64_t end);
+
+  static std::atomic<bool> recording;
+  static std::vector<std::unique_ptr<ZoneTrack> > tracks;   ///< Never shrinks, so tracks of ended threads are exported too
+};
+
+
+inline bool TraceZones::active()
+{
+  return recording.load(std::memory_order_relaxed);
+}
+
+
+/*!
+ * \brief The TraceZone class
+ *
+ * Records time from construction to the end of scope
+ * to track of the calling thread, if zones are started.
+ * Use through TRACE_ZONE().
+ */
+class TraceZone
+{
+
+public:
+  inline explicit TraceZone(const char *name);
+  inline ~TraceZone();
+
+private:
+  const char *zoneName;
+  uint64_t begin;
+  bool timed;
+};
+
+
+inline TraceZone::TraceZone(const char *name)
+{
+  zoneName = name;
+  timed = TraceZones::active();
+  begin = timed ? TraceZones::now() : 0;
+}
+
+
+inline TraceZone::~TraceZone()
+{
+  if(timed)
+    TraceZones::record(zoneName, begin, TraceZones::now());
+}
+
+
+#endif // TRACEZONES_H
@@ -0,0 +1,68 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+
+#define TRIPLE_FRESH 4u     ///< Set in middle index when writer published a slot reader didn't take
+#define TRIPLE_INDEX 3u     ///< Mask of slot index
+
+
+/*!
+ * \brief The TripleBuffer class
+ *
+ * Hands values from one writer thread to one reader thread
+ * without locks. Writer fills \fn writeBuffer() and calls
+ * \fn publish(), reader calls \fn acquire() and reads
+ * \fn readBuffer(). Slots are only exchanged through one
+ * atomic index, so neither side ever waits, and reader
+ * always gets the newest published value. Values that
+ * were published but never acquired are skipped.
+ * Slots are reused, so vectors inside keep their capacity.
+ */
+template<typename T>
+class TripleBuffer
+{
+
+public:
+  TripleBuffer() : back(0), middle(1), front(2)
+  {
+  }
+
+  T &writeBuffer()
+  {
+    return buffers[back];
+  }
+
+  void publish()
+  {
+    back = middle.exchange(back | TRIPLE_FRESH, std::memory_order_acq_rel) & TRIPLE_INDEX;
+  }
+
+  bool fresh() const
+  {
+    return (middle.load(std::memory_order_acquire) & TRIPLE_FRESH) != 0;
+  }
+
+  bool acquire()
+  {
+    if(!fresh())
+      return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & TRIPLE_INDEX;
+    return true;
+  }
+
+  T &readBuffer()
+  {
+    return buffers[front];
+  }
+
+private:
+  T buffers[3];
+  unsigned back;                    ///< Slot owned by writer
+  std::atomic<unsigned> middle;     ///< Slot in between, with TRIPLE_FRESH flag
+  unsigned front;                   ///< Slot owned by reader
+};
+
+
+#endif // TRIPLEBUFFER_H
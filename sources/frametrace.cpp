@@ -0,0 +1,315 @@
+#include "frametrace.h"
+#include <string.h>
+
+
+FrameTrace::FrameTrace()
+{
+  writing = false;
+}
+
+
+FrameTrace::~FrameTrace()
+{
+  close();
+}
+
+
+/*!
+ * \brief FrameTrace::record
+ * \param path trace file to create, replaced if it exists
+ * \return false if file can't be written
+ *
+ * Trace is a magic, a version and then events one after
+ * another, each is one byte of \enum TraceEvent::Type and
+ * its values in native byte order, so it's replayed on
+ * machine of the same endianness.
+ */
+bool FrameTrace::record(const QString &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  file.reset(new QFile(path));
+  if(!file->open(QIODevice::WriteOnly))
+    {
+      file.reset();
+      return false;
+    }
+
+  uint32_t version = TRACE_VERSION;
+  file->write(TRACE_MAGIC, 4);
+  file->write(reinterpret_cast<const char *>(&version), sizeof(version));
+  writing = true;
+  return true;
+}
+
+
+/*!
+ * \brief FrameTrace::replay
+ * \param path trace file written by \fn record()
+ * \return false if file can't be read or isn't a trace
+ *
+ * Events are then read one by one with \fn next().
+ */
+bool FrameTrace::replay(const QString &path)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  writing = false;
+  file.reset(new QFile(path));
+  if(!file->open(QIODevice::ReadOnly))
+    {
+      file.reset();
+      return false;
+    }
+
+  char magic[4];
+  uint32_t version = 0;
+  if(!readBytes(magic, 4) || !readBytes(&version, sizeof(version)) ||
+     (memcmp(magic, TRACE_MAGIC, 4) != 0) || (version != TRACE_VERSION))
+    {
+      file.reset();
+      return false;
+    }
+  return true;
+}
+
+
+/*!
+ * \brief FrameTrace::close
+ *
+ * Flush and close trace file, events
+ * recorded after that are dropped.
+ */
+void FrameTrace::close()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(file)
+    file->close();
+  file.reset();
+  writing = false;
+}
+
+
+/*!
+ * \brief FrameTrace::writeEvent
+ * \param type event to write
+ * \param data fixed size values of event, can be null
+ * \param size size of \param data in bytes
+ *
+ * Should be called with \var lock held.
+ */
+void FrameTrace::writeEvent(TraceEvent::Type type, const void *data, size_t size)
+{
+  uint8_t code = static_cast<uint8_t>(type);
+  file->write(reinterpret_cast<const char *>(&code), 1);
+  if(size > 0)
+    file->write(reinterpret_cast<const char *>(data), size);
+}
+
+
+/*!
+ * \brief FrameTrace::writeArrays
+ * \param xs sample positions
+ * \param ys sample values
+ * \param count number of samples
+ */
+void FrameTrace::writeArrays(const double *xs, const double *ys, size_t count)
+{
+  uint64_t n = count;
+  file->write(reinterpret_cast<const char *>(&n), sizeof(n));
+  file->write(reinterpret_cast<const char *>(xs), count * sizeof(double));
+  file->write(reinterpret_cast<const char *>(ys), count * sizeof(double));
+}
+
+
+/*!
+ * \brief FrameTrace::recordResize
+ * \param width new width of widget
+ * \param height new height of widget
+ */
+void FrameTrace::recordResize(int width, int height)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  int32_t size[2] = { width, height };
+  writeEvent(TraceEvent::resize, size, sizeof(size));
+}
+
+
+/*!
+ * \brief FrameTrace::recordData
+ * \param append samples were appended to series, otherwise they replaced it
+ * \param xs sample positions
+ * \param ys sample values
+ * \param count number of samples
+ */
+void FrameTrace::recordData(bool append, const double *xs, const double *ys, size_t count)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  writeEvent(append ? TraceEvent::appendData : TraceEvent::setData, nullptr, 0);
+  writeArrays(xs, ys, count);
+}
+
+
+/*!
+ * \brief FrameTrace::recordStreamMode
+ * \param capacity number of the latest samples kept
+ * \param window width of scrolling view
+ */
+void FrameTrace::recordStreamMode(size_t capacity, double window)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  uint64_t cap = capacity;
+  writeEvent(TraceEvent::streamMode, &cap, sizeof(cap));
+  file->write(reinterpret_cast<const char *>(&window), sizeof(window));
+}
+
+
+/*!
+ * \brief FrameTrace::recordSamples
+ * \param xs sample positions
+ * \param ys sample values
+ * \param count number of samples
+ *
+ * Can be called from producer thread. Order of samples
+ * and frames in file is the order they were recorded in.
+ */
+void FrameTrace::recordSamples(const double *xs, const double *ys, size_t count)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  writeEvent(TraceEvent::samples, nullptr, 0);
+  writeArrays(xs, ys, count);
+}
+
+
+/*!
+ * \brief FrameTrace::recordLabelStyle
+ * \param value styled label
+ * \param vertical true for label of the left axis
+ * \param style style of label
+ */
+void FrameTrace::recordLabelStyle(double value, bool vertical, const TextStyle &style)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  uint8_t values[6] = { static_cast<uint8_t>(vertical ? 1 : 0),
+                        style.color[0], style.color[1], style.color[2], style.color[3], style.bold };
+  writeEvent(TraceEvent::labelStyle, &value, sizeof(value));
+  file->write(reinterpret_cast<const char *>(values), sizeof(values));
+}
+
+
+/*!
+ * \brief FrameTrace::recordFrame
+ *
+ * Mark that widget was painted with
+ * everything recorded before.
+ */
+void FrameTrace::recordFrame()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!writing)
+    return;
+
+  writeEvent(TraceEvent::frame, nullptr, 0);
+}
+
+
+/*!
+ * \brief FrameTrace::readBytes
+ * \param data buffer to fill
+ * \param size bytes to read
+ * \return false at the end of file
+ */
+bool FrameTrace::readBytes(void *data, size_t size)
+{
+  return file->read(reinterpret_cast<char *>(data), size) == static_cast<qint64>(size);
+}
+
+
+/*!
+ * \brief FrameTrace::readArrays
+ * \param event event to fill \var x and \var y of
+ * \return false if file is cut
+ *
+ * Count is checked against the rest of file before
+ * anything is allocated, so a damaged count fails the
+ * event instead of allocating gigabytes.
+ */
+bool FrameTrace::readArrays(TraceEvent &event)
+{
+  uint64_t count = 0;
+  if(!readBytes(&count, sizeof(count)))
+    return false;
+
+  qint64 available = file->bytesAvailable();
+  if((available < 0) || (count > static_cast<uint64_t>(available) / (2 * sizeof(double))))
+    return false;
+
+  event.x.resize(count);
+  event.y.resize(count);
+  return readBytes(event.x.data(), count * sizeof(double)) &&
+         readBytes(event.y.data(), count * sizeof(double));
+}
+
+
+/*!
+ * \brief FrameTrace::next
+ * \param event the next event of trace, its vectors are reused
+ * \return false at the end of trace or if it's damaged
+ */
+bool FrameTrace::next(TraceEvent &event)
+{
+  std::lock_guard<std::mutex> guard(lock);
+  if(!file || writing)
+    return false;
+
+  uint8_t code = 0;
+  if(!readBytes(&code, 1))
+    return false;
+
+  event.type = static_cast<TraceEvent::Type>(code);
+  switch(event.type)
+    {
+    case TraceEvent::resize:
+      {
+        int32_t size[2];
+        if(!readBytes(size, sizeof(size)))
+          return false;
+        event.width = size[0];
+        event.height = size[1];
+        return true;
+      }
+    case TraceEvent::setData:
+    case TraceEvent::appendData:
+    case TraceEvent::samples:
+      return readArrays(event);
+    case TraceEvent::streamMode:
+      return readBytes(&event.capacity, sizeof(event.capacity)) &&
+             readBytes(&event.value, sizeof(event.value));
+    case TraceEvent::labelStyle:
+      {
+        uint8_t values[6];
+        if(!readBytes(&event.value, sizeof(event.value)) || !readBytes(values, sizeof(values)))
+          return false;
+        event.vertical = values[0];
+        memcpy(event.style.color, values + 1, 4);
+        event.style.bold = values[5];
+        return true;
+      }
+    case TraceEvent::frame:
+      return true;
+    }
+  return false;
+}
@@ -0,0 +1,75 @@
+#ifndef FRAMETRACE_H
+#define FRAMETRACE_H
+
+#include <QString>
+#include <QFile>
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <stdint.h>
+
+#include "textlayout.h"
+
+#define TRACE_MAGIC "PLTR"      ///< First bytes of every trace file
+#define TRACE_VERSION 1u
+
+
+struct TraceEvent
+{
+  enum Type
+  {
+    resize = 1,           ///< Widget size, \var width x \var height
+    setData,              ///< Series replaced by \var x, \var y
+    appendData,           ///< \var x, \var y appended to series
+    streamMode,           ///< Stream of \var capacity samples, view \var value wide
+    samples,              ///< \var x, \var y pushed to stream
+    labelStyle,           ///< Label \var value of axis \var vertical printed with \var style
+    frame                 ///< Widget was painted
+  };
+
+  Type type;
+  int32_t width;
+  int32_t height;
+  uint64_t capacity;
+  double value;
+  uint8_t vertical;
+  TextStyle style;
+  std::vector<double> x;
+  std::vector<double> y;
+};
+
+
+class FrameTrace
+{
+
+public:
+  explicit FrameTrace();
+  ~FrameTrace();
+
+  bool record(const QString &path);
+  bool replay(const QString &path);
+  void close();
+
+  void recordResize(int width, int height);
+  void recordData(bool append, const double *xs, const double *ys, size_t count);
+  void recordStreamMode(size_t capacity, double window);
+  void recordSamples(const double *xs, const double *ys, size_t count);
+  void recordLabelStyle(double value, bool vertical, const TextStyle &style);
+  void recordFrame();
+
+  bool next(TraceEvent &event);
+
+private:
+  void writeEvent(TraceEvent::Type type, const void *data, size_t size);
+  void writeArrays(const double *xs, const double *ys, size_t count);
+  bool readArrays(TraceEvent &event);
+  bool readBytes(void *data, size_t size);
+
+  std::unique_ptr<QFile> file;
+  bool writing;            ///< File was opened by \fn record()
+  std::mutex lock;         ///< Samples are recorded from producer thread, the rest from GUI one
+};
+
+
+#endif // FRAMETRACE_H
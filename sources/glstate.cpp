@@ -0,0 +1,194 @@
+#include "glstate.h"
+
+
+GLState::GLState()
+{
+  issued = 0;
+  skipped = 0;
+  draws = 0;
+  uploaded = 0;
+  invalidate();
+}
+
+
+GLState::~GLState()
+{
+
+}
+
+
+/*!
+ * \brief GLState::initState
+ *
+ * Initialize OpenGL functions. Should be called in
+ * \fn initializeGL() once, before renderers take
+ * the state.
+ */
+void GLState::initState()
+{
+  initializeOpenGLFunctions();
+  invalidate();
+}
+
+
+/*!
+ * \brief GLState::invalidate
+ *
+ * Forget cached bindings, so the next call of each
+ * kind reaches driver. Qt binds its own framebuffer
+ * and could touch other state between paint events,
+ * so should be called at the start of \fn paintGL()
+ * and after objects are bound or deleted outside
+ * of the tracker.
+ */
+void GLState::invalidate()
+{
+  program = UNKNOWN_BINDING;
+  unit = UNKNOWN_BINDING;
+  for(int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    {
+      textures[i] = UNKNOWN_BINDING;
+      targets[i] = UNKNOWN_BINDING;
+    }
+  vao = UNKNOWN_BINDING;
+  arrayBuffer = UNKNOWN_BINDING;
+  scissor = -1;
+}
+
+
+/*!
+ * \brief GLState::count
+ * \param redundant call was skipped
+ */
+void GLState::count(bool redundant)
+{
+  if(redundant)
+    skipped++;
+  else
+    issued++;
+}
+
+
+/*!
+ * \brief GLState::useProgram
+ * \param prog shader program to attach
+ */
+void GLState::useProgram(GLuint prog)
+{
+  count(program == prog);
+  if(program == prog)
+    return;
+
+  glUseProgram(prog);
+  program = prog;
+}
+
+
+/*!
+ * \brief GLState::activeTexture
+ * \param textureUnit GL_TEXTURE0 + index, index below MAX_TEXTURE_UNITS
+ */
+void GLState::activeTexture(GLenum textureUnit)
+{
+  count(unit == textureUnit);
+  if(unit == textureUnit)
+    return;
+
+  glActiveTexture(textureUnit);
+  unit = textureUnit;
+}
+
+
+/*!
+ * \brief GLState::bindTexture
+ * \param textureUnit GL_TEXTURE0 + index, index below MAX_TEXTURE_UNITS
+ * \param texture texture to bind
+ * \param target GL_TEXTURE_2D or GL_TEXTURE_2D_ARRAY
+ *
+ * Active unit is changed only if the texture
+ * bound to \param textureUnit is another one.
+ * Only the last binding of each unit is known, so
+ * using one unit for two targets isn't skipped.
+ */
+void GLState::bindTexture(GLenum textureUnit, GLuint texture, GLenum target)
+{
+  GLuint &bound = textures[textureUnit - GL_TEXTURE0];
+  GLenum &bound_target = targets[textureUnit - GL_TEXTURE0];
+  bool same = (bound == texture) && (bound_target == target);
+  count(same);
+  if(same)
+    return;
+
+  activeTexture(textureUnit);
+  glBindTexture(target, texture);
+  bound = texture;
+  bound_target = target;
+}
+
+
+/*!
+ * \brief GLState::bindVertexArray
+ * \param array vertex array object to bind
+ */
+void GLState::bindVertexArray(GLuint array)
+{
+  count(vao == array);
+  if(vao == array)
+    return;
+
+  glBindVertexArray(array);
+  vao = array;
+}
+
+
+/*!
+ * \brief GLState::bindArrayBuffer
+ * \param buffer vertex buffer object to bind to GL_ARRAY_BUFFER
+ *
+ * Array buffer binding is not a part of vertex
+ * array object, so it's tracked alone.
+ */
+void GLState::bindArrayBuffer(GLuint buffer)
+{
+  count(arrayBuffer == buffer);
+  if(arrayBuffer == buffer)
+    return;
+
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  arrayBuffer = buffer;
+}
+
+
+/*!
+ * \brief GLState::setScissor
+ * \param enabled turn scissor test on or off
+ */
+void GLState::setScissor(bool enabled)
+{
+  int value = enabled ? 1 : 0;
+  count(scissor == value);
+  if(scissor == value)
+    return;
+
+  if(enabled)
+    glEnable(GL_SCISSOR_TEST);
+  else
+    glDisable(GL_SCISSOR_TEST);
+  scissor = value;
+}
+
+
+/*!
+ * \brief GLState::resetCounters
+ *
+ * Start counting issued and skipped calls, draw
+ * calls and uploaded bytes again, e.g. once per
+ * frame for benchmarks.
+ */
+void GLState::resetCounters()
+{
+  issued = 0;
+  skipped = 0;
+  draws = 0;
+  uploaded = 0;
+}
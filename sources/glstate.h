@@ -0,0 +1,91 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+
+#define MAX_TEXTURE_UNITS 8    ///< Texture units whose bindings are tracked
+#define UNKNOWN_BINDING 0xFFFFFFFFu  ///< Binding is not known, next call reaches driver
+
+
+class GLState : protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  explicit GLState();
+  ~GLState();
+
+  void initState();
+  void invalidate();
+
+  void useProgram(GLuint prog);
+  void activeTexture(GLenum textureUnit);
+  void bindTexture(GLenum textureUnit, GLuint texture, GLenum target = GL_TEXTURE_2D);
+  void bindVertexArray(GLuint array);
+  void bindArrayBuffer(GLuint buffer);
+  void setScissor(bool enabled);
+
+  inline void countDraw(unsigned long calls = 1);
+  inline void countUpload(size_t bytes);
+
+  void resetCounters();
+  inline unsigned long getIssued();
+  inline unsigned long getSkipped();
+  inline unsigned long getDraws();
+  inline unsigned long long getUploaded();
+
+private:
+  void count(bool redundant);
+
+  GLuint program;
+  GLenum unit;             ///< Active texture unit
+  GLuint textures[MAX_TEXTURE_UNITS];   ///< Texture last bound to each unit
+  GLenum targets[MAX_TEXTURE_UNITS];    ///< Target it was bound to
+  GLuint vao;
+  GLuint arrayBuffer;
+  int scissor;             ///< Scissor test enabled, -1 if not known
+
+  unsigned long issued;    ///< Calls passed to driver since \fn resetCounters()
+  unsigned long skipped;   ///< Calls dropped as redundant since \fn resetCounters()
+  unsigned long draws;     ///< Draw calls since \fn resetCounters(), counted by renderers
+  unsigned long long uploaded;   ///< Bytes loaded to buffers since \fn resetCounters()
+};
+
+
+inline void GLState::countDraw(unsigned long calls)
+{
+  draws += calls;
+}
+
+
+inline void GLState::countUpload(size_t bytes)
+{
+  uploaded += bytes;
+}
+
+
+inline unsigned long GLState::getIssued()
+{
+  return issued;
+}
+
+
+inline unsigned long GLState::getSkipped()
+{
+  return skipped;
+}
+
+
+inline unsigned long GLState::getDraws()
+{
+  return draws;
+}
+
+
+inline unsigned long long GLState::getUploaded()
+{
+  return uploaded;
+}
+
+
+#endif // GLSTATE_H
@@ -0,0 +1,142 @@
+#include "gpuzones.h"
+
+#ifdef PLOT_TRACE_ZONES
+
+GpuZones::GpuZones()
+{
+  firstZone = 0;
+  offset = 0;
+  ready = false;
+}
+
+
+GpuZones::~GpuZones()
+{
+
+}
+
+
+/*!
+ * \brief GpuZones::initZones
+ *
+ * Create query objects. Should be called in
+ * \fn initializeGL() once.
+ */
+void GpuZones::initZones()
+{
+  initializeOpenGLFunctions();
+  freeQueries.resize(GPU_ZONE_QUERIES);
+  glGenQueries(GPU_ZONE_QUERIES, freeQueries.data());
+  ready = true;
+}
+
+
+/*!
+ * \brief GpuZones::releaseZones
+ *
+ * Delete query objects, zones still in flight are
+ * dropped. Should be called with current context.
+ */
+void GpuZones::releaseZones()
+{
+  if(!ready)
+    return;
+
+  for(size_t i = 0; i < pending.size(); i++)
+    {
+      freeQueries.push_back(pending[i].queries[0]);
+      freeQueries.push_back(pending[i].queries[1]);
+    }
+  pending.clear();
+  glDeleteQueries(freeQueries.size(), freeQueries.data());
+  freeQueries.clear();
+  ready = false;
+}
+
+
+/*!
+ * \brief GpuZones::begin
+ * \param name zone name, string literal
+ * \return zone to pass to \fn end(), GPU_ZONE_NONE if it isn't timed
+ *
+ * Timestamp is written when GPU reaches this point of
+ * command stream, so nothing waits for it here.
+ */
+uint32_t GpuZones::begin(const char *name)
+{
+  if(!ready || !TraceZones::active() || (freeQueries.size() < 2))
+    return GPU_ZONE_NONE;
+
+  Pending zone;
+  zone.name = name;
+  zone.queries[1] = freeQueries.back();
+  freeQueries.pop_back();
+  zone.queries[0] = freeQueries.back();
+  freeQueries.pop_back();
+  zone.ended = false;
+  glQueryCounter(zone.queries[0], GL_TIMESTAMP);
+
+  pending.push_back(zone);
+  return firstZone + pending.size() - 1;
+}
+
+
+/*!
+ * \brief GpuZones::end
+ * \param zone from \fn begin()
+ */
+void GpuZones::end(uint32_t zone)
+{
+  if((zone == GPU_ZONE_NONE) || (zone - firstZone >= pending.size()))
+    return;
+
+  Pending &entry = pending[zone - firstZone];
+  glQueryCounter(entry.queries[1], GL_TIMESTAMP);
+  entry.ended = true;
+}
+
+
+/*!
+ * \brief GpuZones::collect
+ *
+ * Read zones GPU has finished, in order, and record
+ * them to GPU track of \class TraceZones. Zones that
+ * aren't finished yet are left for one of the next
+ * frames, so reading never stalls. GPU clock is matched
+ * to \fn TraceZones::now() every call, so GPU zones sit
+ * on the same timeline as CPU ones. Call once a frame,
+ * e.g. at the beginning of \fn paintGL().
+ */
+void GpuZones::collect()
+{
+  if(!ready || pending.empty())
+    return;
+
+  GLint64 gpuNow = 0;
+  glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+  offset = static_cast<int64_t>(TraceZones::now()) - gpuNow;
+
+  while(!pending.empty() && pending.front().ended)
+    {
+      Pending &zone = pending.front();
+      GLint available = 0;
+      glGetQueryObjectiv(zone.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+      if(!available)
+        break;
+
+      GLuint64 begin = 0;
+      GLuint64 end = 0;
+      glGetQueryObjectui64v(zone.queries[0], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(zone.queries[1], GL_QUERY_RESULT, &end);
+      int64_t cpuBegin = static_cast<int64_t>(begin) + offset;
+      int64_t cpuEnd = static_cast<int64_t>(end) + offset;
+      if(cpuBegin >= 0)
+        TraceZones::recordGpu(zone.name, cpuBegin, cpuEnd);
+
+      freeQueries.push_back(zone.queries[0]);
+      freeQueries.push_back(zone.queries[1]);
+      pending.pop_front();
+      firstZone++;
+    }
+}
+#endif
@@ -0,0 +1,103 @@
+#ifndef GPUZONES_H
+#define GPUZONES_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <vector>
+#include <deque>
+#include <stdint.h>
+
+#include "tracezones.h"
+
+#define GPU_ZONE_QUERIES 256      ///< Timestamp queries of one widget, two per zone in flight
+#define GPU_ZONE_NONE 0xFFFFFFFFu ///< Zone that isn't timed, zones are stopped or queries ran out
+
+
+#ifdef PLOT_TRACE_ZONES
+#define GPU_ZONE(zones, name) GpuZone TRACE_ZONE_JOIN(gpuZone, __LINE__)(zones, name)
+#else
+#define GPU_ZONE(zones, name)
+#endif
+
+
+#ifdef PLOT_TRACE_ZONES
+class GpuZones : protected QOpenGLFunctions_3_3_Core
+{
+
+  struct Pending
+  {
+    const char *name;
+    GLuint queries[2];    ///< Timestamps of begin and end of zone
+    bool ended;
+  };
+
+public:
+  explicit GpuZones();
+  ~GpuZones();
+
+  void initZones();
+  void releaseZones();
+
+  uint32_t begin(const char *name);
+  void end(uint32_t zone);
+  void collect();
+
+private:
+  std::vector<GLuint> freeQueries;
+  std::deque<Pending> pending;   ///< Zones in order they began, results are read from the front
+  uint32_t firstZone;            ///< Number of zone at the front of \var pending
+  int64_t offset;                ///< \fn TraceZones::now() minus GPU timestamp
+  bool ready;
+};
+#else
+/*!
+ * \brief The GpuZones class
+ *
+ * Empty without PLOT_TRACE_ZONES, widgets call it
+ * the same way and nothing is compiled in.
+ */
+class GpuZones
+{
+
+public:
+  inline void initZones() {}
+  inline void releaseZones() {}
+  inline void collect() {}
+};
+#endif
+
+
+#ifdef PLOT_TRACE_ZONES
+/*!
+ * \brief The GpuZone class
+ *
+ * Times commands issued from construction to the end of
+ * scope on GPU. Use through GPU_ZONE().
+ */
+class GpuZone
+{
+
+public:
+  inline GpuZone(GpuZones &gpuZones, const char *name);
+  inline ~GpuZone();
+
+private:
+  GpuZones &zones;
+  uint32_t zone;
+};
+
+
+inline GpuZone::GpuZone(GpuZones &gpuZones, const char *name) : zones(gpuZones)
+{
+  zone = zones.begin(name);
+}
+
+
+inline GpuZone::~GpuZone()
+{
+  zones.end(zone);
+}
+#endif
+
+
+#endif // GPUZONES_H
@@ -2,14 +2,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <algorithm>
 
 #include <QPainter>
 #include <QLabel>
+#include <chrono>
 
 
 Plot::Plot(QWidget *parent)
 {
   (void)parent;
+
+  /*TEST VALUES-------------------------------------------*/
+  view.left = 0;
+  view.right = 10000;
+  view.bottom = 0;
+  view.top = 10;
+  /*--------------------------------------------TEST VALUES*/
+
+  wgtWidth = 0;
+  wgtHeight = 0;
+  streamWindow = 0;
+  trace = nullptr;
 }
 
 
@@ -23,17 +37,21 @@ Plot::~Plot()
  * \brief Plot::initializeGL OpenGl initialization
  *
  * Function is called once after creating OpenGL widget.
- * To use OpenGL newer than 2.0, inherit class from
- * \class QOpenGLFunctions and call
- * \fn initializeOpenGLFunctions()
+ * OpenGL newer than 2.0 is resolved by
+ * \fn PlotWidget::initWidget()
  */
 void Plot::initializeGL()
 {
-  initializeOpenGLFunctions();
+  initWidget();
 
   glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
 
-  rendertext.initTextRender();
+  // labels are laid out on worker thread, repaint when they are ready
+  rendertext.setDevicePixelRatio(devicePixelRatioF());
+  rendertext.initTextRender(&glstate, [this]() { QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection); });
+  renderseries.initSeriesRender(&glstate);
+  if(stream)
+    renderstream.initStreamRender(stream.get(), &glstate);
 }
 
 
@@ -49,29 +67,49 @@ void Plot::initializeGL()
  */
 void Plot::resizeGL(int width, int height)
 {
-  glMatrixMode(GL_PROJECTION);
-  glLoadIdentity();
+  glstate.invalidate();
+  if(trace)
+    trace.load()->recordResize(width, height);
+
   glViewport(0, 0, width, height);
 
-  /*TEST VALUES-------------------------------------------*/
-  proj.left = 0;
-  proj.right = 10000;
-  proj.bottom = 0;
-  proj.top = 10;
+  wgtWidth = width;
+  wgtHeight = height;
+  rendertext.invalidateLayers();
+
+  updateTicks();
+
+  proj = view;
+  updatePixels();
+}
 
-  x = {proj.left, (proj.left + proj.right) * 0.2, (proj.left + proj.right) * 0.4,
-       (proj.left + proj.right) * 0.6, (proj.left + proj.right) * 0.8, proj.right};
 
-  y = {proj.bottom, (proj.bottom + proj.top) * 0.2, (proj.bottom + proj.top) * 0.4,
-       (proj.bottom + proj.top) * 0.6, (proj.bottom + proj.top) * 0.8, proj.top};
+/*!
+ * \brief Plot::updateTicks
+ *
+ * Choose how many labels to put on axes from pixel
+ * length of each axis and measured label size,
+ * see \class AxisTicks. Labels are formatted and
+ * loaded to \class RenderText only when active
+ * level of detail is changed.
+ */
+void Plot::updateTicks()
+{
+  TRACE_ZONE("ticks");
+  xTicks.setRange(view.left, view.right);
+  yTicks.setRange(view.bottom, view.top);
 
-  rendertext.setText(y, x);
-  /*--------------------------------------------TEST VALUES*/
+  // pixels left for axes after reserving space for text in the last layout
+  int x_pixels = wgtWidth - rendertext.getTextMaxWidth() - rendertext.getCharacterWidth();
+  int y_pixels = wgtHeight - rendertext.getCharacterHeight();
 
-  wgtWidth = width;
-  wgtHeight = height;
+  bool y_changed = yTicks.selectLevel(y_pixels, false, rendertext.getMetrics());
+  bool x_changed = xTicks.selectLevel(x_pixels, true, rendertext.getMetrics());
 
-  updatePixels();
+  if(x_changed || y_changed)
+    {
+      rendertext.setText(yTicks.values(), xTicks.values());
+    }
 }
 
 
@@ -87,6 +125,7 @@ void Plot::resizeGL(int width, int height)
  */
 void Plot::updatePixels()
 {
+  TRACE_ZONE("reserve space");
   rendertext.setProjMatrix(proj);
 
   pixelWidth = (proj.right - proj.left)/static_cast<double>(wgtWidth);
@@ -105,9 +144,185 @@ void Plot::updatePixels()
 // update current projection matrix after reserving space
   proj = rendertext.getProjMatrix();
 
-// load changed projection matrix to shaders
+// load changed projection matrix to shaders, chrome frames view
   rendertext.updateShaderMatrix();
+  rendertext.setPlotArea(view);
   rendertext.updateTextPositions();
+
+// series is decimated to pixel columns of view
+  int columns = static_cast<int>((view.right - view.left) / pixelWidth + 0.5);
+  renderseries.setView(view, proj, columns);
+  renderseries.updateShaderMatrix();
+  renderstream.setView(proj);
+  renderstream.updateShaderMatrix();
+
+// data is clipped to view, so it's not drawn over text
+  double ratio = devicePixelRatioF();
+  rendertext.setDevicePixelRatio(ratio);
+  GLint clip_x = static_cast<GLint>((view.left - proj.left) / pixelWidth * ratio + 0.5);
+  GLint clip_y = static_cast<GLint>((view.bottom - proj.bottom) / pixelHeight * ratio + 0.5);
+  GLsizei clip_width = static_cast<GLsizei>(columns * ratio + 0.5);
+  GLsizei clip_height = static_cast<GLsizei>((view.top - view.bottom) / pixelHeight * ratio + 0.5);
+  renderseries.setClip(clip_x, clip_y, clip_width, clip_height);
+  renderstream.setClip(clip_x, clip_y, clip_width, clip_height);
+}
+
+
+/*!
+ * \brief Plot::waitTextLayout
+ *
+ * Block until layout thread finishes labels of the
+ * newest view, so the next paint draws them. Replay
+ * calls it before every frame, so counts of frames
+ * are the same on every run.
+ */
+void Plot::waitTextLayout()
+{
+  rendertext.waitLayout();
+}
+
+
+/*!
+ * \brief Plot::setData
+ * \param xs sample positions, sorted ascending
+ * \param ys sample values
+ *
+ * Replace data series drawn in the plot.
+ */
+void Plot::setData(const std::vector<double> &xs, const std::vector<double> &ys)
+{
+  x = xs;
+  y = ys;
+  if(trace)
+    trace.load()->recordData(false, xs.data(), ys.data(), std::min(xs.size(), ys.size()));
+  renderseries.setData(x.data(), y.data(), std::min(x.size(), y.size()));
+  dataset.reset();
+  update();
+}
+
+
+/*!
+ * \brief Plot::appendData
+ * \param xs sample positions, greater than the last one in \var x
+ * \param ys sample values
+ *
+ * Append samples to data series, only appended
+ * part of min/max pyramid is built. Mapped
+ * dataset is read only, nothing is appended to it.
+ */
+void Plot::appendData(const std::vector<double> &xs, const std::vector<double> &ys)
+{
+  if(dataset)
+    return;
+
+  x.insert(x.end(), xs.begin(), xs.end());
+  y.insert(y.end(), ys.begin(), ys.end());
+  if(trace)
+    trace.load()->recordData(true, xs.data(), ys.data(), std::min(xs.size(), ys.size()));
+  renderseries.appendData(x.data(), y.data(), std::min(x.size(), y.size()));
+  update();
+}
+
+
+/*!
+ * \brief Plot::openDataset
+ * \param path dataset file, see \class MappedDataset
+ * \return false if file can't be opened, series is kept then
+ *
+ * Replace data series with columns of memory mapped file,
+ * samples aren't copied or read on open. Min/max pyramid
+ * is seeded from chunk summary of file, so only samples
+ * at edges of pixel columns in view are touched when the
+ * series is drawn. View is fitted to the whole series.
+ * Series of dataset is not recorded to trace.
+ */
+bool Plot::openDataset(const QString &path)
+{
+  std::unique_ptr<MappedDataset> opened(new MappedDataset());
+  if(!opened->open(path) || (opened->size() == 0))
+    return false;
+
+  // columns of the previous file are unmapped only after series is switched
+  renderseries.setData(opened->x(), opened->y(), opened->size(), opened->summary(), opened->chunkSamples());
+  dataset = std::move(opened);
+  x.clear();
+  y.clear();
+
+  double min = 0;
+  double max = 0;
+  renderseries.dataRange(&min, &max);
+  view.left = dataset->x()[0];
+  view.right = dataset->x()[dataset->size() - 1];
+  view.bottom = min;
+  view.top = max;
+  if(view.right <= view.left)
+    view.right = view.left + 1;
+  if(view.top <= view.bottom)
+    view.top = view.bottom + 1;
+
+  if((wgtWidth > 0) && (wgtHeight > 0))
+    {
+      makeCurrent();
+      updateTicks();
+      proj = view;
+      updatePixels();
+      doneCurrent();
+    }
+  update();
+  return true;
+}
+
+
+/*!
+ * \brief Plot::setStreamMode
+ * \param capacity number of the latest samples to keep
+ * \param window width of scrolling view in sample positions
+ *
+ * Switch plot to streaming time series. Samples are kept in
+ * a ring of fixed \param capacity, so memory stays bounded no
+ * matter how long the stream runs, and view scrolls to the
+ * newest sample. Should be called before widget is shown.
+ */
+void Plot::setStreamMode(size_t capacity, double window)
+{
+  stream.reset(new StreamBuffer(capacity));
+  streamWindow = window;
+  if(trace)
+    trace.load()->recordStreamMode(capacity, window);
+}
+
+
+/*!
+ * \brief Plot::appendSample
+ * \param xs sample position, greater than the last one
+ * \param ys sample value
+ *
+ * Can be called from one producer thread other than GUI one,
+ * never waits. Only for stream mode, see \fn setStreamMode().
+ */
+void Plot::appendSample(double xs, double ys)
+{
+  appendSamples(&xs, &ys, 1);
+}
+
+
+/*!
+ * \brief Plot::appendSamples
+ * \param xs sample positions, ascending
+ * \param ys sample values
+ * \param count number of samples
+ *
+ * Same as \fn appendSample(), for a batch of samples.
+ */
+void Plot::appendSamples(const double *xs, const double *ys, size_t count)
+{
+  if(!stream)
+    return;
+
+  FrameTrace *recorder = trace;
+  if(recorder)
+    recorder->recordSamples(xs, ys, count);
+  stream->push(xs, ys, count);
 }
 
 
@@ -122,20 +337,30 @@ void Plot::updatePixels()
  */
 void Plot::paintGL()
 {
-  makeCurrent();                            // Change render context
-  glClear(GL_COLOR_BUFFER_BIT);             // Clear current color buffer
+  TRACE_ZONE("paintGL");
+  beginFrame();
+  GPU_ZONE(gpuZones, "frame");
+  if(trace)
+    trace.load()->recordFrame();
+
+  // load samples streamed since the last frame and scroll view to the newest one
+  if(renderstream.updateStream())
+    {
+      view.right = renderstream.lastX();
+      view.left = view.right - streamWindow;
+      updateTicks();
+      proj = view;
+      updatePixels();
+    }
 
-  glMatrixMode(GL_PROJECTION);              // Change to projection mode to enable multiplication between current and perspective matrix
-  glLoadIdentity();                         // Clear current render matrix
+  glClear(GL_COLOR_BUFFER_BIT);             // Clear current color buffer
 
-  // Create perspective matrix with pixel based coordinates
-  // to enable nice text interpolation so it won't be fuzzy
-  glOrtho(proj.left,
-          proj.right,
-          proj.bottom,
-          proj.top,
-          -1, 1);
-  glMatrixMode(GL_MODELVIEW);
+  // every renderer loads its own orthographic matrix,
+  // chrome goes under data and annotations over it
+  {
+    GPU_ZONE(gpuZones, "chrome");
+    rendertext.renderChrome();
+  }
 
 //  rendertext.renderTextEasy(3654, ((proj.left + proj.right) / 4), 0, Arrange::horizontal);
 //  rendertext.renderTextEasy(20189, ((proj.left + proj.right) / 2), 0, Arrange::horizontal);
@@ -144,8 +369,194 @@ void Plot::paintGL()
 //  rendertext.renderTextEasy(420.97, proj.left + (pixelWidth * 4), ((proj.bottom + proj.top) * 0.75), Arrange::vertical);
 //  rendertext.renderTextEasy(563.41, 0, ((proj.bottom + proj.top) / 2), Arrange::vertical);
 //  rendertext.renderTextEasy(0, 0, ((proj.bottom + proj.top) / 4), Arrange::vertical);
-  rendertext.renderText();
+  {
+    GPU_ZONE(gpuZones, "series");
+    renderseries.renderSeries();
+    renderstream.renderStream();
+  }
+  {
+    GPU_ZONE(gpuZones, "labels");
+    rendertext.renderMatrix();
+    rendertext.renderLabels();
+  }
+
+}
+
+
+/*!
+ * \brief Plot::setLabelStyle
+ * \param value axis label to style
+ * \param vertical true for label of the left axis
+ * \param style color, opacity and emphasis, e.g. red warning level
+ *
+ * Labels of all styles are still rendered in one batch.
+ */
+void Plot::setLabelStyle(double value, bool vertical, const TextStyle &style)
+{
+  if(trace)
+    trace.load()->recordLabelStyle(value, vertical, style);
+  rendertext.setLabelStyle(value, vertical ? TextLayout::vertical : TextLayout::horizontal, style);
+  rendertext.updateTextPositions();
+  update();
+}
+
+
+/*!
+ * \brief Plot::addLabel
+ * \param text annotation to print
+ * \param xPos left edge of text in data values
+ * \param yPos bottom edge of text in data values
+ * \param style color, opacity and emphasis
+ * \param anchor rotation of text and its point put at \param xPos, \param yPos
+ * \return id of label, INVALID_LABEL if it couldn't be added
+ *
+ * Annotation stays at its data position when view changes.
+ * Rotated annotations are drawn with the rest of them.
+ */
+LabelId Plot::addLabel(const std::string &text, double xPos, double yPos, const TextStyle &style,
+                       const TextAnchor &anchor)
+{
+  LabelId id = rendertext.addLabel(text, xPos, yPos, style, anchor);
+  update();
+  return id;
+}
+
+
+/*!
+ * \brief Plot::updateLabel
+ * \param id label from \fn addLabel()
+ * \param text new annotation
+ * \param xPos new left edge of text
+ * \param yPos new bottom edge of text
+ * \param style new style
+ * \param anchor new rotation and alignment
+ * \return false if label was already removed
+ *
+ * Only the slot of label is loaded again, repaints
+ * of many updates between frames are merged.
+ */
+bool Plot::updateLabel(LabelId id, const std::string &text, double xPos, double yPos, const TextStyle &style,
+                       const TextAnchor &anchor)
+{
+  bool found = rendertext.updateLabel(id, text, xPos, yPos, style, anchor);
+  if(found)
+    update();
+  return found;
+}
+
+
+/*!
+ * \brief Plot::removeLabel
+ * \param id label from \fn addLabel()
+ * \return false if label was already removed
+ */
+bool Plot::removeLabel(LabelId id)
+{
+  bool found = rendertext.removeLabel(id);
+  if(found)
+    update();
+  return found;
+}
+
+
+/*!
+ * \brief Plot::setMatrix
+ * \param values row after row, kept by caller while matrix
+ *    is shown, null to remove matrix
+ * \param rows rows of matrix
+ * \param columns columns of matrix
+ * \param stride values from one row to the next one
+ * \param area data values matrix covers, row 0 at the top
+ *
+ * Print value in every cell of matrix, e.g. of heatmap
+ * drawn under it. Only cells fully inside view are
+ * formatted, labels are hidden while cells are too
+ * small for them. Matrix is not recorded to trace.
+ */
+void Plot::setMatrix(const double *values, size_t rows, size_t columns, size_t stride, const Proj &area)
+{
+  rendertext.setMatrix(values, rows, columns, stride, area);
+  update();
+}
+
 
+/*!
+ * \brief Plot::updateMatrixCell
+ * \param row cell which value changed in buffer
+ * \param column
+ *
+ * Only label of the cell is loaded again,
+ * repaints of many updates between frames
+ * are merged.
+ */
+void Plot::updateMatrixCell(size_t row, size_t column)
+{
+  rendertext.updateMatrixCell(row, column);
+  update();
+}
+
+
+/*!
+ * \brief Plot::updateMatrix
+ *
+ * All values of matrix changed in buffer.
+ */
+void Plot::updateMatrix()
+{
+  rendertext.updateMatrix();
+  update();
+}
+
+
+/*!
+ * \brief Plot::textMemory
+ * \return bytes text of the widget holds on CPU and GPU,
+ *    as of the last frame
+ */
+TextMemory Plot::textMemory()
+{
+  return rendertext.memoryUsage();
+}
+
+
+/*!
+ * \brief Plot::setTextBudget
+ * \param cpuBytes CPU bytes of text, 0 is unlimited
+ * \param gpuBytes GPU bytes of text without shared atlases, 0 is unlimited
+ *
+ * See \fn RenderText::setMemoryBudget().
+ */
+void Plot::setTextBudget(size_t cpuBytes, size_t gpuBytes)
+{
+  rendertext.setMemoryBudget(cpuBytes, gpuBytes);
+  update();
+}
+
+
+/*!
+ * \brief Plot::setTrace
+ * \param recorder trace opened with \fn FrameTrace::record(),
+ *    null to stop recording
+ *
+ * Record inputs of the widget: size, data, streamed
+ * samples, label styles and paint events, so session
+ * can be replayed with plot_replay. Stream mode and
+ * data already set are recorded first, samples streamed
+ * before and label styles set before are not. Recorder
+ * should outlive recording.
+ */
+void Plot::setTrace(FrameTrace *recorder)
+{
+  if(recorder)
+    {
+      if(stream)
+        recorder->recordStreamMode(stream->capacity(), streamWindow);
+      if(!x.empty())
+        recorder->recordData(false, x.data(), y.data(), std::min(x.size(), y.size()));
+      if((wgtWidth > 0) && (wgtHeight > 0))
+        recorder->recordResize(wgtWidth, wgtHeight);
+    }
+  trace = recorder;
 }
 
 
@@ -159,11 +570,28 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent)
 
   plot = new Plot();
   grid->addWidget(plot,0,0,1,1);
+
+  /*TEST VALUES-------------------------------------------*/
+  std::vector<double> xs(1000000);
+  std::vector<double> ys(xs.size());
+  for(uint i = 0; i < xs.size(); i++)
+    {
+      xs[i] = i * (10000.0 / xs.size());
+      ys[i] = 5 + 3 * sin(xs[i] / 300) + (rand() % 1000) / 1000.0;
+    }
+  plot->setData(xs, ys);
+
+  streamPlot = new Plot();
+  streamPlot->setStreamMode(200000, 2.0);
+  grid->addWidget(streamPlot,1,0,1,1);
+  producing = true;
+  producer = std::thread(&MainWindow::produce, this);
+  /*--------------------------------------------TEST VALUES*/
 //  grid->addWidget(glplot1,1,0,1,1);
 
   QTimer *timer = new QTimer(this);
   timer->connect(timer, &QTimer::timeout, this, &MainWindow::replot);
-  timer->start(120);
+  timer->start(16);
 //  timer->singleShot(15,this, &MainWindow::replot);
 
   // debug testing QPainter text draw
@@ -201,7 +629,36 @@ MainWindow::MainWindow(QWidget *parent): QMainWindow(parent)
 
 MainWindow::~MainWindow()
 {
+  producing = false;
+  if(producer.joinable())
+    producer.join();
+  streamPlot->setTrace(nullptr);
+}
+
 
+/*!
+ * \brief MainWindow::recordTrace
+ * \param path trace file to create
+ * \return false if file can't be written or session is recorded already
+ *
+ * Record session of \var streamPlot, for
+ * frame time benchmarks with plot_replay.
+ * Producer thread could be recording samples,
+ * so recorder is kept until window is closed.
+ */
+bool MainWindow::recordTrace(const QString &path)
+{
+  if(recorder)
+    return false;
+
+  recorder.reset(new FrameTrace());
+  if(!recorder->record(path))
+    {
+      recorder.reset();
+      return false;
+    }
+  streamPlot->setTrace(recorder.get());
+  return true;
 }
 
 
@@ -210,6 +667,7 @@ void MainWindow::replot()
 //  double time1 = clock() / static_cast<double>(CLOCKS_PER_SEC);
 
   plot->update();
+  streamPlot->update();
 
 
 //  double time2 = clock() / static_cast<double>(CLOCKS_PER_SEC);
@@ -218,3 +676,32 @@ void MainWindow::replot()
 //  printf("CPU TIME: %.6f sec\n", cpu_time);
 //  printf("\n");
 }
+
+
+/*!
+ * \brief MainWindow::produce
+ *
+ * Test sensor, runs in its own thread and
+ * feeds \var streamPlot at 20 kHz.
+ */
+void MainWindow::produce()
+{
+  const double rate = 20000;
+  const size_t batch = 100;
+  double xs[batch];
+  double ys[batch];
+  size_t n = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  while(producing)
+    {
+      for(size_t i = 0; i < batch; i++, n++)
+        {
+          xs[i] = n / rate;
+          ys[i] = 5 + 3 * sin(8.17 * xs[i]) + (rand() % 1000) / 1000.0;
+        }
+      streamPlot->appendSamples(xs, ys, batch);
+
+      std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<long long>(n * 1e6 / rate)));
+    }
+}
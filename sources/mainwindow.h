@@ -11,20 +11,56 @@
 #include <math.h>
 #include <iostream>
 #include <QPushButton>
+#include <memory>
+#include <thread>
+#include <atomic>
 
-#include "rendertext.h"
+#include "plotwidget.h"
+#include "axisticks.h"
+#include "renderseries.h"
+#include "renderstream.h"
+#include "frametrace.h"
+#include "mappeddataset.h"
+#include "gpuzones.h"
 
-class Plot : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+class Plot : public PlotWidget
 {
   Q_OBJECT
 
 public:
   explicit Plot(QWidget *parent = nullptr);
   ~Plot();
-  std::vector<double> x;
-  std::vector<double> y;
+  std::vector<double> x;      ///< Data series positions, sorted ascending
+  std::vector<double> y;      ///< Data series values
+
+  void setData(const std::vector<double> &xs, const std::vector<double> &ys);
+  void appendData(const std::vector<double> &xs, const std::vector<double> &ys);
+  bool openDataset(const QString &path);
+
+  void setStreamMode(size_t capacity, double window);
+  void appendSample(double xs, double ys);
+  void appendSamples(const double *xs, const double *ys, size_t count);
+
+  void setLabelStyle(double value, bool vertical, const TextStyle &style);
+
+  LabelId addLabel(const std::string &text, double xPos, double yPos, const TextStyle &style,
+                   const TextAnchor &anchor = defaultAnchor);
+  bool updateLabel(LabelId id, const std::string &text, double xPos, double yPos, const TextStyle &style,
+                   const TextAnchor &anchor = defaultAnchor);
+  bool removeLabel(LabelId id);
+
+  void setMatrix(const double *values, size_t rows, size_t columns, size_t stride, const Proj &area);
+  void updateMatrixCell(size_t row, size_t column);
+  void updateMatrix();
 
   void updatePixels();
+  void updateTicks();
+  void waitTextLayout();
+
+  TextMemory textMemory();
+  void setTextBudget(size_t cpuBytes, size_t gpuBytes);
+
+  void setTrace(FrameTrace *recorder);
 
 protected:
   void initializeGL() override;
@@ -32,8 +68,16 @@ protected:
   void paintGL() override;
 
 private:
-  RenderText rendertext;
+  RenderSeries renderseries;
+  RenderStream renderstream;
+  std::unique_ptr<StreamBuffer> stream;   ///< Ring of streamed samples, null if not in stream mode
+  std::unique_ptr<MappedDataset> dataset; ///< Mapped file series is drawn from, null if it's drawn from \var x, \var y
+  std::atomic<FrameTrace *> trace;        ///< Records inputs of the widget, null if not recording
+  double streamWindow;    ///< Width of scrolling view in stream mode
+  AxisTicks xTicks;
+  AxisTicks yTicks;
 
+  Proj view;              ///< Range of values to show, before space for text is reserved
   Proj proj;
   double pixelWidth;
   double pixelHeight;
@@ -50,10 +94,19 @@ class MainWindow : public QMainWindow
 public:
   MainWindow(QWidget *parent = nullptr);
   ~MainWindow();
+  bool recordTrace(const QString &path);
   Plot *plot;
+  Plot *streamPlot;
   QWidget *w;
 
 public slots:
   void replot();
+
+private:
+  void produce();
+
+  std::thread producer;             ///< Test sensor feeding \var streamPlot
+  std::atomic<bool> producing;
+  std::unique_ptr<FrameTrace> recorder;   ///< Trace of \var streamPlot, see \fn recordTrace()
 };
 #endif // MAINWINDOW_H
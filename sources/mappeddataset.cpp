@@ -0,0 +1,166 @@
+#include "mappeddataset.h"
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#include <QSaveFile>
+
+
+MappedDataset::MappedDataset()
+{
+  memory = nullptr;
+  columnX = nullptr;
+  columnY = nullptr;
+  chunks = nullptr;
+  samples = 0;
+  chunkSize = 0;
+}
+
+
+MappedDataset::~MappedDataset()
+{
+  close();
+}
+
+
+/*!
+ * \brief MappedDataset::open
+ * \param path dataset file, see \struct DatasetHeader
+ * \return false if file can't be mapped or isn't a valid dataset
+ *
+ * File is mapped, not read, so opening costs the same for any
+ * size and columns are used in place. Only pages that are
+ * touched become resident, e.g. samples of the current view
+ * and edges of its pixel columns. Views stay valid until
+ * \fn close() or the next \fn open().
+ */
+bool MappedDataset::open(const QString &path)
+{
+  close();
+
+  file.reset(new QFile(path));
+  if(!file->open(QIODevice::ReadOnly))
+    {
+      file.reset();
+      return false;
+    }
+
+  qint64 length = file->size();
+  if(length < static_cast<qint64>(sizeof(DatasetHeader)))
+    {
+      close();
+      return false;
+    }
+
+  memory = file->map(0, length);
+  if(memory == nullptr)
+    {
+      close();
+      return false;
+    }
+
+  DatasetHeader header;
+  memcpy(&header, memory, sizeof(header));
+
+  uint64_t bytes = header.samples * sizeof(double);
+  uint64_t size = static_cast<uint64_t>(length);
+  bool valid = (memcmp(header.magic, DATASET_MAGIC, 4) == 0) &&
+               (header.version == DATASET_VERSION) && (header.type == DATASET_DOUBLE) &&
+               (header.samples < size / sizeof(double)) &&
+               (header.xOffset % sizeof(double) == 0) && (header.yOffset % sizeof(double) == 0) &&
+               (header.xOffset <= size) && (bytes <= size - header.xOffset) &&
+               (header.yOffset <= size) && (bytes <= size - header.yOffset);
+
+  uint64_t chunkCount = (header.chunkSamples > 0) ? header.samples / header.chunkSamples : 0;
+  if(valid && (header.summaryOffset != 0))
+    {
+      uint64_t summaryBytes = chunkCount * 2 * sizeof(double);
+      valid = (header.chunkSamples > 0) && (header.summaryOffset % sizeof(double) == 0) &&
+              (header.summaryOffset <= size) && (summaryBytes <= size - header.summaryOffset);
+    }
+
+  if(!valid)
+    {
+      close();
+      return false;
+    }
+
+  columnX = reinterpret_cast<const double *>(memory + header.xOffset);
+  columnY = reinterpret_cast<const double *>(memory + header.yOffset);
+  samples = header.samples;
+  if(header.summaryOffset != 0)
+    {
+      chunks = reinterpret_cast<const double *>(memory + header.summaryOffset);
+      chunkSize = header.chunkSamples;
+    }
+  return true;
+}
+
+
+/*!
+ * \brief MappedDataset::close
+ *
+ * Unmap file, views taken from it are not valid anymore.
+ */
+void MappedDataset::close()
+{
+  if(file && (memory != nullptr))
+    file->unmap(memory);
+  file.reset();
+  memory = nullptr;
+  columnX = nullptr;
+  columnY = nullptr;
+  chunks = nullptr;
+  samples = 0;
+  chunkSize = 0;
+}
+
+
+/*!
+ * \brief MappedDataset::write
+ * \param path dataset file to create
+ * \param xs sample positions, sorted ascending
+ * \param ys sample values
+ * \param count number of samples
+ * \param chunkSamples samples per chunk of summary, a power of
+ *    PYRAMID_FACTOR so \class MinMaxPyramid can be seeded from it,
+ *    0 for file without summary
+ * \return false if file can't be written
+ *
+ * Header is followed by column of positions, column of values
+ * and summary of full chunks, all in native byte order.
+ */
+bool MappedDataset::write(const QString &path, const double *xs, const double *ys, size_t count,
+                          size_t chunkSamples)
+{
+  size_t chunkCount = (chunkSamples > 0) ? count / chunkSamples : 0;
+  std::vector<double> summary(chunkCount * 2);
+  for(size_t c = 0; c < chunkCount; c++)
+    {
+      const double *first = ys + c * chunkSamples;
+      summary[c * 2] = *std::min_element(first, first + chunkSamples);
+      summary[c * 2 + 1] = *std::max_element(first, first + chunkSamples);
+    }
+
+  DatasetHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, DATASET_MAGIC, 4);
+  header.version = DATASET_VERSION;
+  header.type = DATASET_DOUBLE;
+  header.chunkSamples = (chunkCount > 0) ? chunkSamples : 0;
+  header.samples = count;
+  header.xOffset = sizeof(DatasetHeader);
+  header.yOffset = header.xOffset + count * sizeof(double);
+  header.summaryOffset = (chunkCount > 0) ? header.yOffset + count * sizeof(double) : 0;
+
+  QSaveFile out(path);
+  if(!out.open(QIODevice::WriteOnly))
+    return false;
+
+  out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+  out.write(reinterpret_cast<const char *>(xs), count * sizeof(double));
+  out.write(reinterpret_cast<const char *>(ys), count * sizeof(double));
+  if(chunkCount > 0)
+    out.write(reinterpret_cast<const char *>(summary.data()), summary.size() * sizeof(double));
+  return out.commit();
+}
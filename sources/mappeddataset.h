@@ -0,0 +1,91 @@
+#ifndef MAPPEDDATASET_H
+#define MAPPEDDATASET_H
+
+#include <QString>
+#include <QFile>
+
+#include <memory>
+#include <stdint.h>
+#include <stddef.h>
+
+#define DATASET_MAGIC "PLDS"    ///< First bytes of every dataset file
+#define DATASET_VERSION 1u
+#define DATASET_DOUBLE 1u       ///< Columns of 64-bit IEEE doubles, native byte order
+#define DATASET_CHUNK 1024u     ///< Default samples per chunk of summary, a power of PYRAMID_FACTOR
+
+
+struct DatasetHeader
+{
+  char magic[4];          ///< DATASET_MAGIC
+  uint32_t version;       ///< DATASET_VERSION
+  uint32_t type;          ///< Type of columns, DATASET_DOUBLE
+  uint32_t chunkSamples;  ///< Samples per chunk of summary, 0 if file has none
+  uint64_t samples;       ///< Number of samples in each column
+  uint64_t xOffset;       ///< Byte offset of column of positions, sorted ascending, 8 aligned
+  uint64_t yOffset;       ///< Byte offset of column of values, 8 aligned
+  uint64_t summaryOffset; ///< Byte offset of [min | max] of values per full chunk, 0 if none
+  uint64_t reserved;
+};
+
+
+class MappedDataset
+{
+
+public:
+  explicit MappedDataset();
+  ~MappedDataset();
+
+  bool open(const QString &path);
+  void close();
+
+  static bool write(const QString &path, const double *xs, const double *ys, size_t count,
+                    size_t chunkSamples = DATASET_CHUNK);
+
+  inline const double *x();
+  inline const double *y();
+  inline size_t size();
+  inline const double *summary();
+  inline size_t chunkSamples();
+
+private:
+  std::unique_ptr<QFile> file;
+  uchar *memory;           ///< Whole file mapped read only, pages are loaded when touched
+  const double *columnX;
+  const double *columnY;
+  const double *chunks;    ///< [min | max] pairs, null if file has no summary
+  size_t samples;
+  size_t chunkSize;
+};
+
+
+inline const double *MappedDataset::x()
+{
+  return columnX;
+}
+
+
+inline const double *MappedDataset::y()
+{
+  return columnY;
+}
+
+
+inline size_t MappedDataset::size()
+{
+  return samples;
+}
+
+
+inline const double *MappedDataset::summary()
+{
+  return chunks;
+}
+
+
+inline size_t MappedDataset::chunkSamples()
+{
+  return chunkSize;
+}
+
+
+#endif // MAPPEDDATASET_H
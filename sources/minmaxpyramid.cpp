@@ -0,0 +1,298 @@
+#include "minmaxpyramid.h"
+#include <algorithm>
+
+
+MinMaxPyramid::MinMaxPyramid()
+{
+  samples = 0;
+  base = 1;
+}
+
+
+MinMaxPyramid::~MinMaxPyramid()
+{
+
+}
+
+
+/*!
+ * \brief MinMaxPyramid::clear
+ *
+ * Drop all levels, pyramid holds no samples after it.
+ */
+void MinMaxPyramid::clear()
+{
+  levels.clear();
+  samples = 0;
+  base = 1;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::build
+ * \param y sample values
+ * \param size number of samples
+ *
+ * Build all levels from scratch.
+ */
+void MinMaxPyramid::build(const double *y, size_t size)
+{
+  clear();
+  append(y, size);
+}
+
+
+/*!
+ * \brief MinMaxPyramid::append
+ * \param y sample values, including ones pyramid was already built for
+ * \param size number of samples
+ *
+ * Incremental rebuild. Every level holds only full nodes,
+ * so samples appended after the last call only add nodes
+ * to the end of each level, nothing is recalculated.
+ */
+void MinMaxPyramid::append(const double *y, size_t size)
+{
+  if(size < samples)
+    {
+      build(y, size);
+      return;
+    }
+
+  size_t count = size;
+  for(size_t level = 1; ; level++)
+    {
+      count /= PYRAMID_FACTOR;
+      if(count == 0)
+        break;
+
+      if(levels.size() < level)
+        levels.push_back(std::vector<Node>());
+
+      // levels below summary of seeded pyramid stay unbuilt
+      if(level < base)
+        continue;
+
+      levels[level - 1].reserve(count);
+      for(size_t j = levels[level - 1].size(); j < count; j++)
+        {
+          size_t child = j * PYRAMID_FACTOR;
+          Node node;
+          nodeRange(y, level - 1, child, &node.min, &node.max);
+          for(size_t k = 1; k < PYRAMID_FACTOR; k++)
+            {
+              double min = 0;
+              double max = 0;
+              nodeRange(y, level - 1, child + k, &min, &max);
+              node.min = std::min(node.min, min);
+              node.max = std::max(node.max, max);
+            }
+          levels[level - 1].push_back(node);
+        }
+    }
+
+  samples = size;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::seed
+ * \param y sample values, not read here
+ * \param size number of samples
+ * \param summary [min | max] pairs of each full chunk of \param y
+ * \param chunkSamples samples in chunk, a power of PYRAMID_FACTOR
+ * \return false if chunk size doesn't match a level, pyramid is empty then
+ *
+ * Take level of chunks from precomputed summary, e.g. of memory
+ * mapped file, and build only levels above it, so samples are
+ * not touched. Nodes below are read from samples when range
+ * needs them, that's at most a chunk at each edge of range.
+ */
+bool MinMaxPyramid::seed(const double *y, size_t size, const double *summary, size_t chunkSamples)
+{
+  clear();
+
+  size_t level = 0;
+  size_t span = 1;
+  while(span < chunkSamples)
+    {
+      span *= PYRAMID_FACTOR;
+      level++;
+    }
+  if((level == 0) || (span != chunkSamples))
+    return false;
+
+  size_t chunks = size / chunkSamples;
+  levels.resize(level);
+  levels[level - 1].resize(chunks);
+  for(size_t i = 0; i < chunks; i++)
+    {
+      levels[level - 1][i].min = summary[i * 2];
+      levels[level - 1][i].max = summary[i * 2 + 1];
+    }
+
+  // levels above chunks are built as usual, from nodes of the level below
+  base = level;
+  samples = chunks * chunkSamples;
+  append(y, size);
+  return true;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::spanRange
+ * \param y sample values
+ * \param level level of node that is not built
+ * \param i index of node in its level
+ * \param min lowest value of node
+ * \param max highest value of node
+ */
+void MinMaxPyramid::spanRange(const double *y, size_t level, size_t i, double *min, double *max)
+{
+  size_t span = 1;
+  for(size_t l = 0; l < level; l++)
+    span *= PYRAMID_FACTOR;
+
+  const double *first = y + i * span;
+  double lo = first[0];
+  double hi = first[0];
+  for(size_t k = 1; k < span; k++)
+    {
+      lo = std::min(lo, first[k]);
+      hi = std::max(hi, first[k]);
+    }
+  *min = lo;
+  *max = hi;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::range
+ * \param y sample values
+ * \param begin first sample of range
+ * \param end sample after the last one of range
+ * \param min lowest value in range
+ * \param max highest value in range
+ *
+ * Find min and max of samples in range. Edges of range are taken
+ * from lower levels until they are aligned to the nodes of upper
+ * level, the middle is taken from the highest level, so it costs
+ * O(PYRAMID_FACTOR * levels) instead of O(end - begin).
+ */
+void MinMaxPyramid::range(const double *y, size_t begin, size_t end, double *min, double *max)
+{
+  double lo = y[begin];
+  double hi = lo;
+  double node_min = 0;
+  double node_max = 0;
+  size_t level = 0;
+  size_t span = 1;
+
+  while(begin < end)
+    {
+      size_t parent = span * PYRAMID_FACTOR;
+      bool up = (level < levels.size());
+
+      while((begin < end) && (!up || (begin % parent != 0)))
+        {
+          nodeRange(y, level, begin / span, &node_min, &node_max);
+          lo = std::min(lo, node_min);
+          hi = std::max(hi, node_max);
+          begin += span;
+        }
+
+      while((begin < end) && (!up || (end % parent != 0)))
+        {
+          end -= span;
+          nodeRange(y, level, end / span, &node_min, &node_max);
+          lo = std::min(lo, node_min);
+          hi = std::max(hi, node_max);
+        }
+
+      level++;
+      span = parent;
+    }
+
+  *min = lo;
+  *max = hi;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::decimate
+ * \param x sample positions, sorted ascending
+ * \param y sample values
+ * \param size number of samples
+ * \param left lowest x in view
+ * \param right highest x in view
+ * \param columns number of pixel columns in view
+ * \param vertices [x - \param left | y] pairs of polyline to draw
+ *
+ * Fold samples in view into pixel columns, every column
+ * gives two vertices, it's min and max value, so the polyline
+ * has at most 2 * \param columns + 2 vertices no matter how
+ * many samples there are. If view holds less samples than
+ * that, they are all put as is. One sample outside of view
+ * on each side is kept, so the line goes to the edges.
+ * Positions are relative to \param left, subtracted in
+ * double, so floats hold pixels however far view is
+ * from zero.
+ */
+void MinMaxPyramid::decimate(const double *x, const double *y, size_t size,
+                             double left, double right, int columns, std::vector<float> &vertices)
+{
+  vertices.clear();
+
+  size = std::min(size, samples);
+  if((size == 0) || (columns <= 0) || !(right > left))
+    return;
+
+  size_t first = std::lower_bound(x, x + size, left) - x;
+  size_t last = std::upper_bound(x, x + size, right) - x;
+
+  vertices.reserve((columns + 2) * 4);
+
+  if(first > 0)
+    {
+      vertices.push_back(x[first - 1] - left);
+      vertices.push_back(y[first - 1]);
+    }
+
+  if(last - first <= static_cast<size_t>(columns) * 2)
+    {
+      for(size_t i = first; i < last; i++)
+        {
+          vertices.push_back(x[i] - left);
+          vertices.push_back(y[i]);
+        }
+    }
+  else
+    {
+      double width = (right - left) / columns;
+      size_t begin = first;
+      for(int c = 0; (c < columns) && (begin < last); c++)
+        {
+          double edge = left + (c + 1) * width;
+          size_t end = (c == columns - 1) ? last : std::upper_bound(x + begin, x + last, edge) - x;
+          if(end == begin)
+            continue;
+
+          double min = 0;
+          double max = 0;
+          range(y, begin, end, &min, &max);
+
+          float center = (c + 0.5) * width;
+          vertices.push_back(center);
+          vertices.push_back(min);
+          vertices.push_back(center);
+          vertices.push_back(max);
+          begin = end;
+        }
+    }
+
+  if(last < size)
+    {
+      vertices.push_back(x[last] - left);
+      vertices.push_back(y[last]);
+    }
+}
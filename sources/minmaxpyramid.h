@@ -0,0 +1,79 @@
+#ifndef MINMAXPYRAMID_H
+#define MINMAXPYRAMID_H
+
+#include <vector>
+#include <stddef.h>
+
+
+#define PYRAMID_FACTOR 4        ///< number of samples folded into one node of the next level
+
+
+class MinMaxPyramid
+{
+
+  struct Node
+  {
+    double min;
+    double max;
+  };
+
+public:
+  explicit MinMaxPyramid();
+  ~MinMaxPyramid();
+
+  void build(const double *y, size_t size);
+  void append(const double *y, size_t size);
+  bool seed(const double *y, size_t size, const double *summary, size_t chunkSamples);
+  void clear();
+
+  void range(const double *y, size_t begin, size_t end, double *min, double *max);
+  void decimate(const double *x, const double *y, size_t size,
+                double left, double right, int columns, std::vector<float> &vertices);
+
+  inline size_t size();
+
+private:
+  inline void nodeRange(const double *y, size_t level, size_t i, double *min, double *max);
+  void spanRange(const double *y, size_t level, size_t i, double *min, double *max);
+
+  std::vector<std::vector<Node> > levels;   ///< levels[l] holds nodes of PYRAMID_FACTOR^(l+1) samples
+  size_t samples;                           ///< number of samples pyramid was built for
+  size_t base;                              ///< the lowest level that is built, ones below are read from samples
+};
+
+
+inline size_t MinMaxPyramid::size()
+{
+  return samples;
+}
+
+
+/*!
+ * \brief MinMaxPyramid::nodeRange
+ * \param y sample values
+ * \param level level of node
+ * \param i index of node in its level
+ * \param min lowest value of node
+ * \param max highest value of node
+ *
+ * Node below \var base is read from samples,
+ * both values in one pass over them.
+ */
+inline void MinMaxPyramid::nodeRange(const double *y, size_t level, size_t i, double *min, double *max)
+{
+  if(level == 0)
+    {
+      *min = y[i];
+      *max = y[i];
+    }
+  else if(level < base)
+    spanRange(y, level, i, min, max);
+  else
+    {
+      *min = levels[level - 1][i].min;
+      *max = levels[level - 1][i].max;
+    }
+}
+
+
+#endif // MINMAXPYRAMID_H
@@ -0,0 +1,216 @@
+#include "plotcanvas.h"
+#include <algorithm>
+
+
+PlotCanvas::PlotCanvas(QWidget *parent) : PlotWidget(parent)
+{
+  columns = 1;
+  wgtWidth = 0;
+  wgtHeight = 0;
+  deviceRatio = 1;
+  ready = false;
+}
+
+
+PlotCanvas::~PlotCanvas()
+{
+  makeCurrent();
+  for(size_t i = 0; i < panels.size(); i++)
+    panels[i]->releasePanel();
+  doneCurrent();
+}
+
+
+/*!
+ * \brief PlotCanvas::addPanel
+ * \return new panel, owned by canvas
+ *
+ * Panels fill grid row by row, from the top left
+ * corner, see \fn setColumns().
+ */
+PlotPanel *PlotCanvas::addPanel()
+{
+  panels.push_back(std::unique_ptr<PlotPanel>(new PlotPanel()));
+  if(ready)
+    {
+      makeCurrent();
+      initPanel(*panels.back());
+      doneCurrent();
+    }
+  arrangePanels();
+  update();
+  return panels.back().get();
+}
+
+
+/*!
+ * \brief PlotCanvas::panel
+ * \param index order panel was added in
+ * \return panel, null if there's no such one
+ *
+ * Call \fn update() after panel is changed.
+ */
+PlotPanel *PlotCanvas::panel(size_t index)
+{
+  if(index >= panels.size())
+    return nullptr;
+  return panels[index].get();
+}
+
+
+/*!
+ * \brief PlotCanvas::setColumns
+ * \param count panels in a row of grid
+ */
+void PlotCanvas::setColumns(int count)
+{
+  columns = (count > 0) ? count : 1;
+  arrangePanels();
+  update();
+}
+
+
+/*!
+ * \brief PlotCanvas::initPanel
+ * \param added panel to create buffers for, context is current
+ *
+ * The first panel compiles series program,
+ * the others take it.
+ */
+void PlotCanvas::initPanel(PlotPanel &added)
+{
+  GLuint program = (panels.front().get() != &added) ? panels.front()->getSeriesProgram() : 0;
+  added.initPanel(&glstate, program, rendertext);
+}
+
+
+/*!
+ * \brief PlotCanvas::arrangePanels
+ *
+ * Split canvas into grid of panels. Edges are
+ * whole logical pixels, so neighbour panels
+ * neither overlap nor leave a gap.
+ */
+void PlotCanvas::arrangePanels()
+{
+  if(panels.empty() || (wgtWidth <= 0) || (wgtHeight <= 0))
+    return;
+
+  int cols = std::min(columns, static_cast<int>(panels.size()));
+  int rows = (static_cast<int>(panels.size()) + cols - 1) / cols;
+  for(size_t i = 0; i < panels.size(); i++)
+    {
+      int col = i % cols;
+      int row = i / cols;
+      int left = col * wgtWidth / cols;
+      int right = (col + 1) * wgtWidth / cols;
+      int top = wgtHeight - row * wgtHeight / rows;
+      int bottom = wgtHeight - (row + 1) * wgtHeight / rows;
+      panels[i]->setGeometry(left, bottom, right - left, top - bottom, deviceRatio);
+    }
+}
+
+
+/*!
+ * \brief PlotCanvas::initializeGL
+ *
+ * Context is shared by all panels, see
+ * \fn Plot::initializeGL().
+ */
+void PlotCanvas::initializeGL()
+{
+  initWidget();
+
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+  deviceRatio = devicePixelRatioF();
+  rendertext.setDevicePixelRatio(deviceRatio);
+  rendertext.initTextRender(&glstate, [this]() { QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection); });
+  for(size_t i = 0; i < panels.size(); i++)
+    initPanel(*panels[i]);
+  ready = true;
+}
+
+
+/*!
+ * \brief PlotCanvas::resizeGL
+ * \param width passed by Qt, in logical pixels
+ * \param height passed by Qt
+ *
+ * Text batch is in logical pixels of canvas,
+ * so its matrix only changes here.
+ */
+void PlotCanvas::resizeGL(int width, int height)
+{
+  glstate.invalidate();
+
+  wgtWidth = width;
+  wgtHeight = height;
+  deviceRatio = devicePixelRatioF();
+  rendertext.setDevicePixelRatio(deviceRatio);
+
+  Proj pixels;
+  pixels.left = 0;
+  pixels.right = width;
+  pixels.bottom = 0;
+  pixels.top = height;
+  rendertext.setProjMatrix(pixels);
+  rendertext.updateShaderMatrix();
+
+  arrangePanels();
+}
+
+
+/*!
+ * \brief PlotCanvas::paintGL
+ *
+ * Panels that changed are laid out again and text of
+ * all of them is rebuilt into one batch, which is
+ * loaded and drawn in one call over the whole surface.
+ * Then series of each panel is drawn in its own
+ * viewport, scissored to its view. Binding of program
+ * and atlas is kept from panel to panel.
+ */
+void PlotCanvas::paintGL()
+{
+  TRACE_ZONE("paintGL canvas");
+  beginFrame();
+  GPU_ZONE(gpuZones, "frame");
+
+  // canvas could be moved to a screen of another pixel ratio
+  if(devicePixelRatioF() != deviceRatio)
+    {
+      deviceRatio = devicePixelRatioF();
+      rendertext.setDevicePixelRatio(deviceRatio);
+      arrangePanels();
+    }
+
+  bool changed = false;
+  for(size_t i = 0; i < panels.size(); i++)
+    changed = panels[i]->updateLayout() || changed;
+
+  if(changed)
+    {
+      TRACE_ZONE("batch panels");
+      textBatch.clear();
+      for(size_t i = 0; i < panels.size(); i++)
+        panels[i]->appendText(textBatch);
+    }
+
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  {
+    GPU_ZONE(gpuZones, "chrome");
+    rendertext.renderBatch(textBatch, changed);
+  }
+  {
+    GPU_ZONE(gpuZones, "series");
+    for(size_t i = 0; i < panels.size(); i++)
+      panels[i]->renderSeries();
+  }
+
+  glViewport(0, 0, static_cast<GLsizei>(wgtWidth * deviceRatio + 0.5),
+             static_cast<GLsizei>(wgtHeight * deviceRatio + 0.5));
+}
+
+
@@ -0,0 +1,61 @@
+#ifndef PLOTCANVAS_H
+#define PLOTCANVAS_H
+
+#include <vector>
+#include <memory>
+
+#include "plotwidget.h"
+#include "plotpanel.h"
+
+
+/*!
+ * \brief The PlotCanvas class
+ *
+ * Many plots in one OpenGL surface. Panels are arranged
+ * in a grid, each gets its own viewport, scissor and
+ * projection matrix, while context, bindings, atlas and
+ * programs are shared. Labels and chrome of all panels
+ * are one vertex batch and one draw call, series are one
+ * draw per panel, so cost of frame grows with panels
+ * only by their series.
+ */
+class PlotCanvas : public PlotWidget
+{
+  Q_OBJECT
+
+public:
+  explicit PlotCanvas(QWidget *parent = nullptr);
+  ~PlotCanvas();
+
+  PlotPanel *addPanel();
+  PlotPanel *panel(size_t index);
+  inline size_t panelCount();
+  void setColumns(int count);
+
+protected:
+  void initializeGL() override;
+  void resizeGL(int width, int height) override;
+  void paintGL() override;
+
+private:
+  void initPanel(PlotPanel &added);
+  void arrangePanels();
+
+  std::vector<std::unique_ptr<PlotPanel> > panels;
+  std::vector<GlyphVertex> textBatch;   ///< Labels and chrome of all panels, in logical pixels of canvas
+
+  int columns;            ///< Panels in a row of grid
+  int wgtWidth;
+  int wgtHeight;
+  double deviceRatio;     ///< Device pixel ratio panels are arranged for
+  bool ready;             ///< \fn initializeGL() was called
+};
+
+
+inline size_t PlotCanvas::panelCount()
+{
+  return panels.size();
+}
+
+
+#endif // PLOTCANVAS_H
@@ -0,0 +1,257 @@
+#include "plotpanel.h"
+#include "tracezones.h"
+#include <algorithm>
+
+
+PlotPanel::PlotPanel()
+{
+  view.left = 0;
+  view.right = 1;
+  view.bottom = 0;
+  view.top = 1;
+  proj = view;
+  pixelWidth = 1;
+  pixelHeight = 1;
+
+  rectLeft = 0;
+  rectBottom = 0;
+  rectWidth = 0;
+  rectHeight = 0;
+  deviceRatio = 1;
+  dirty = true;
+  ready = false;
+}
+
+
+PlotPanel::~PlotPanel()
+{
+
+}
+
+
+/*!
+ * \brief PlotPanel::initPanel
+ * \param glstate bindings tracker of canvas context
+ * \param program series program of another panel, 0 to compile one
+ * \param text renderer of canvas, gives glyph metrics of the atlas
+ *
+ * Should be called in \fn initializeGL() of canvas, or
+ * with its context current, after \fn RenderText::initTextRender().
+ */
+void PlotPanel::initPanel(GLState *glstate, GLuint program, RenderText &text)
+{
+  initializeOpenGLFunctions();
+  series.initSeriesRender(glstate, program);
+  text.setupLayout(layout);
+  metrics.setCharacterSize(text.getCharacterWidth(), text.getCharacterHeight());
+  ready = true;
+  dirty = true;
+}
+
+
+/*!
+ * \brief PlotPanel::releasePanel
+ *
+ * Should be called with context of canvas current.
+ */
+void PlotPanel::releasePanel()
+{
+  series.releaseSeriesRender();
+  ready = false;
+}
+
+
+/*!
+ * \brief PlotPanel::setData
+ * \param xs sample positions, sorted ascending
+ * \param ys sample values
+ *
+ * Replace data series of panel, view is kept.
+ */
+void PlotPanel::setData(const std::vector<double> &xs, const std::vector<double> &ys)
+{
+  x = xs;
+  y = ys;
+  series.setData(x.data(), y.data(), std::min(x.size(), y.size()));
+}
+
+
+/*!
+ * \brief PlotPanel::appendData
+ * \param xs sample positions, greater than the last one in \var x
+ * \param ys sample values
+ */
+void PlotPanel::appendData(const std::vector<double> &xs, const std::vector<double> &ys)
+{
+  x.insert(x.end(), xs.begin(), xs.end());
+  y.insert(y.end(), ys.begin(), ys.end());
+  series.appendData(x.data(), y.data(), std::min(x.size(), y.size()));
+}
+
+
+/*!
+ * \brief PlotPanel::setView
+ * \param range values to show in panel
+ *
+ * Panel is laid out again at the next render of canvas.
+ */
+void PlotPanel::setView(const Proj &range)
+{
+  view = range;
+  dirty = true;
+}
+
+
+/*!
+ * \brief PlotPanel::setGeometry
+ * \param left left edge of panel in logical pixels of canvas
+ * \param bottom bottom edge, counted from the bottom of canvas
+ * \param width
+ * \param height
+ * \param ratio device pixel ratio of canvas
+ */
+void PlotPanel::setGeometry(int left, int bottom, int width, int height, double ratio)
+{
+  rectLeft = left;
+  rectBottom = bottom;
+  rectWidth = width;
+  rectHeight = height;
+  deviceRatio = ratio;
+  dirty = true;
+}
+
+
+/*!
+ * \brief PlotPanel::updateLayout
+ * \return true if labels or chrome of panel changed
+ *
+ * Choose ticks, reserve space for text and lay out
+ * labels and chrome, if view or geometry changed since
+ * the last call. Layout is small enough for a panel to
+ * run on GUI thread, it's skipped for still panels.
+ */
+bool PlotPanel::updateLayout()
+{
+  if(!dirty || !ready || (rectWidth <= 0) || (rectHeight <= 0))
+    return false;
+
+  TRACE_ZONE("panel layout");
+  updateTicks();
+  proj = view;
+  updatePixels();
+  dirty = false;
+  return true;
+}
+
+
+/*!
+ * \brief PlotPanel::updateTicks
+ *
+ * Same as \fn Plot::updateTicks(), for
+ * rectangle of panel.
+ */
+void PlotPanel::updateTicks()
+{
+  xTicks.setRange(view.left, view.right);
+  yTicks.setRange(view.bottom, view.top);
+
+  // pixels left for axes after reserving space for text in the last layout
+  int x_pixels = rectWidth - metrics.getTextMaxWidth() - metrics.getCharacterWidth();
+  int y_pixels = rectHeight - metrics.getCharacterHeight();
+
+  bool y_changed = yTicks.selectLevel(y_pixels, false, metrics);
+  bool x_changed = xTicks.selectLevel(x_pixels, true, metrics);
+
+  if(x_changed || y_changed)
+    {
+      metrics.measureLabels(yTicks.values());
+      layout.setText(yTicks.values(), xTicks.values(), std::vector<TextStyle>(), std::vector<TextStyle>());
+    }
+}
+
+
+/*!
+ * \brief PlotPanel::updatePixels
+ *
+ * Same as \fn Plot::updatePixels(), but labels
+ * are laid out here and clip of series is
+ * moved to rectangle of panel.
+ */
+void PlotPanel::updatePixels()
+{
+  metrics.setProjMatrix(proj);
+
+  metrics.setPixelWidth((proj.right - proj.left)/static_cast<double>(rectWidth));
+  metrics.setPixelHeight((proj.top - proj.bottom)/static_cast<double>(rectHeight));
+
+// reserve enough space in panel for text rendering
+  metrics.reserveSpace(rectWidth, rectHeight);
+
+  pixelWidth = metrics.getPixelWidth();
+  pixelHeight = metrics.getPixelHeight();
+  proj = metrics.getProjMatrix();
+
+  layout.setOrigin(TextLayout::hintToPixel(proj.left, pixelWidth), TextLayout::hintToPixel(proj.bottom, pixelHeight));
+  layout.setDeviceScale(deviceRatio);
+  layout.setView(proj, pixelWidth, pixelHeight);
+  layout.setPlotArea(view);
+  layout.updateTextPositions();
+  layout.buildFrame(frame);
+
+// series is decimated to pixel columns of view
+  int columns = static_cast<int>((view.right - view.left) / pixelWidth + 0.5);
+  series.setView(view, proj, columns);
+  series.updateShaderMatrix();
+
+// scissor is in framebuffer pixels of the whole canvas
+  GLint clip_x = static_cast<GLint>((rectLeft + (view.left - proj.left) / pixelWidth) * deviceRatio + 0.5);
+  GLint clip_y = static_cast<GLint>((rectBottom + (view.bottom - proj.bottom) / pixelHeight) * deviceRatio + 0.5);
+  GLsizei clip_width = static_cast<GLsizei>(columns * deviceRatio + 0.5);
+  GLsizei clip_height = static_cast<GLsizei>((view.top - view.bottom) / pixelHeight * deviceRatio + 0.5);
+  series.setClip(clip_x, clip_y, clip_width, clip_height);
+}
+
+
+/*!
+ * \brief PlotPanel::appendText
+ * \param out batch of canvas, in logical pixels of canvas
+ *    from the bottom left corner
+ *
+ * Append labels and chrome of panel moved from values
+ * of \var proj to rectangle of panel. Layout hints
+ * glyphs to whole pixels of panel and panel starts at
+ * a whole pixel, so they stay sharp. Vertices are
+ * relative to origin of frame, next to the bottom left
+ * corner of \var proj, so they are whole pixels however
+ * far view is from zero.
+ */
+void PlotPanel::appendText(std::vector<GlyphVertex> &out)
+{
+  size_t offset = out.size();
+  double shift_x = frame.originX - proj.left;
+  double shift_y = frame.originY - proj.bottom;
+  out.insert(out.end(), frame.vertices.begin(), frame.vertices.end());
+  for(size_t i = offset; i < out.size(); i++)
+    {
+      out[i].x = static_cast<float>(rectLeft + (out[i].x + shift_x) / pixelWidth);
+      out[i].y = static_cast<float>(rectBottom + (out[i].y + shift_y) / pixelHeight);
+    }
+}
+
+
+/*!
+ * \brief PlotPanel::renderSeries
+ *
+ * Viewport is set to rectangle of panel, so series
+ * keeps its own projection matrix. Canvas should
+ * restore viewport after the last panel.
+ */
+void PlotPanel::renderSeries()
+{
+  if(!ready || (rectWidth <= 0) || (rectHeight <= 0))
+    return;
+
+  glViewport(static_cast<GLint>(rectLeft * deviceRatio + 0.5), static_cast<GLint>(rectBottom * deviceRatio + 0.5),
+             static_cast<GLsizei>(rectWidth * deviceRatio + 0.5), static_cast<GLsizei>(rectHeight * deviceRatio + 0.5));
+  series.renderSeries();
+}
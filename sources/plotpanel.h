@@ -0,0 +1,79 @@
+#ifndef PLOTPANEL_H
+#define PLOTPANEL_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <vector>
+
+#include "glstate.h"
+#include "rendertext.h"
+#include "renderseries.h"
+#include "axisticks.h"
+#include "textlayout.h"
+#include "textmetrics.h"
+
+
+/*!
+ * \brief The PlotPanel class
+ *
+ * One plot of \class PlotCanvas, in a rectangle of the
+ * canvas surface. Holds its own view, ticks and series,
+ * labels and chrome are laid out on GUI thread and given
+ * to canvas, which renders text of all panels at once.
+ */
+class PlotPanel : protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  explicit PlotPanel();
+  ~PlotPanel();
+
+  void initPanel(GLState *glstate, GLuint program, RenderText &text);
+  void releasePanel();
+  inline GLuint getSeriesProgram();
+
+  void setData(const std::vector<double> &xs, const std::vector<double> &ys);
+  void appendData(const std::vector<double> &xs, const std::vector<double> &ys);
+  void setView(const Proj &range);
+  void setGeometry(int left, int bottom, int width, int height, double ratio);
+
+  bool updateLayout();
+  void appendText(std::vector<GlyphVertex> &out);
+  void renderSeries();
+
+private:
+  void updateTicks();
+  void updatePixels();
+
+  std::vector<double> x;   ///< Data series positions, sorted ascending
+  std::vector<double> y;   ///< Data series values
+
+  TextMetrics metrics;     ///< Projection matrix, pixel sizes and label widths of panel
+  TextLayout layout;       ///< Labels and chrome of panel, laid out on GUI thread
+  TextFrame frame;         ///< Output of \var layout, in values of \var proj
+  AxisTicks xTicks;
+  AxisTicks yTicks;
+  RenderSeries series;
+
+  Proj view;              ///< Range of values to show, before space for text is reserved
+  Proj proj;
+  double pixelWidth;
+  double pixelHeight;
+
+  int rectLeft;           ///< Rectangle of panel in logical pixels of canvas, from the bottom left corner
+  int rectBottom;
+  int rectWidth;
+  int rectHeight;
+  double deviceRatio;     ///< Device pixel ratio of canvas
+  bool dirty;             ///< View or rectangle changed since the last \fn updateLayout()
+  bool ready;             ///< \fn initPanel() was called
+};
+
+
+inline GLuint PlotPanel::getSeriesProgram()
+{
+  return series.getProgram();
+}
+
+
+#endif // PLOTPANEL_H
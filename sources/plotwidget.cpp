@@ -0,0 +1,87 @@
+#include "plotwidget.h"
+
+
+PlotWidget::PlotWidget(QWidget *parent) : QOpenGLWidget(parent)
+{
+
+}
+
+
+PlotWidget::~PlotWidget()
+{
+  // shared text resources are deleted with the last widget,
+  // context should be current for that
+  makeCurrent();
+  rendertext.releaseTextRender();
+  gpuZones.releaseZones();
+  doneCurrent();
+}
+
+
+/*!
+ * \brief PlotWidget::initWidget
+ *
+ * Call from \fn initializeGL() of widget,
+ * before its renderers are initialized.
+ */
+void PlotWidget::initWidget()
+{
+  initializeOpenGLFunctions();
+  glstate.initState();
+  gpuZones.initZones();
+}
+
+
+/*!
+ * \brief PlotWidget::beginFrame
+ *
+ * Call first in \fn paintGL() of widget. Counters
+ * then hold only calls of the frame.
+ */
+void PlotWidget::beginFrame()
+{
+  makeCurrent();
+  gpuZones.collect();                       // GPU zones of previous frames that are finished
+  glstate.invalidate();                     // Qt could bind its own objects since the last frame
+  glstate.resetCounters();
+}
+
+
+/*!
+ * \brief PlotWidget::issuedCalls
+ * \return binding calls passed to driver in the last frame
+ */
+unsigned long PlotWidget::issuedCalls()
+{
+  return glstate.getIssued();
+}
+
+
+/*!
+ * \brief PlotWidget::skippedCalls
+ * \return redundant binding calls dropped in the last frame
+ */
+unsigned long PlotWidget::skippedCalls()
+{
+  return glstate.getSkipped();
+}
+
+
+/*!
+ * \brief PlotWidget::drawCalls
+ * \return draw calls of the last frame
+ */
+unsigned long PlotWidget::drawCalls()
+{
+  return glstate.getDraws();
+}
+
+
+/*!
+ * \brief PlotWidget::uploadedBytes
+ * \return bytes loaded to vertex buffers in the last frame
+ */
+unsigned long long PlotWidget::uploadedBytes()
+{
+  return glstate.getUploaded();
+}
@@ -0,0 +1,43 @@
+#ifndef PLOTWIDGET_H
+#define PLOTWIDGET_H
+
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions_3_3_Core>
+
+#include "glstate.h"
+#include "rendertext.h"
+#include "gpuzones.h"
+
+
+/*!
+ * \brief The PlotWidget class
+ *
+ * Scaffolding every OpenGL widget of the library shares:
+ * bindings tracker, text renderer, GPU trace zones and
+ * counters of the last frame. Widgets call \fn initWidget()
+ * from \fn initializeGL() and \fn beginFrame() first in
+ * \fn paintGL(), text and zones are released here.
+ */
+class PlotWidget : public QOpenGLWidget, protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  explicit PlotWidget(QWidget *parent = nullptr);
+  ~PlotWidget();
+
+  unsigned long issuedCalls();
+  unsigned long skippedCalls();
+  unsigned long drawCalls();
+  unsigned long long uploadedBytes();
+
+protected:
+  void initWidget();
+  void beginFrame();
+
+  GLState glstate;        ///< Bindings of the widget context, shared by renderers
+  GpuZones gpuZones;      ///< GPU time of render stages, on timeline of \class TraceZones
+  RenderText rendertext;
+};
+
+
+#endif // PLOTWIDGET_H
@@ -0,0 +1,280 @@
+#include "renderseries.h"
+#include "tracezones.h"
+
+
+const char *vertexShaderSeries =
+    "#version 330 core\n"
+    "layout (location = 0) in vec2 vertex;\n"
+    "uniform mat4 ModelViewProjectionMatrix;\n"
+    "void main()\n"
+    " {\n"
+    "   gl_Position = ModelViewProjectionMatrix * vec4(vertex.xy, 0.0, 1.0);\n"
+    " }\n";
+
+
+const char *fragmentShaderSeries =
+    "#version 330 core\n"
+    "out vec4 Color;\n"
+    "vec3 lineColor = vec3(0.0, 0.35, 0.75);\n"
+    "void main()\n"
+    " {\n"
+    "   Color = vec4(lineColor, 1.0);\n"
+    " }\n";
+
+
+RenderSeries::RenderSeries()
+{
+  dataX = nullptr;
+  dataY = nullptr;
+  dataSize = 0;
+  columns = 0;
+  dirty = false;
+  clip.x = 0;
+  clip.y = 0;
+  clip.width = 0;
+  clip.height = 0;
+  state = nullptr;
+  series_prog = 0;
+  ownProgram = false;
+  series_matrix = -1;
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      projMatrix[i][j] = (i == j) ? 1 : 0;
+  series_VBO = 0;
+  series_VAO = 0;
+}
+
+
+RenderSeries::~RenderSeries()
+{
+
+}
+
+
+/*!
+ * \brief RenderSeries::initSeriesRender
+ * \param glstate bindings tracker of widget context
+ * \param program program of another series renderer of the
+ *    same context, 0 to compile its own
+ *
+ * Initialize OpenGL functions, create shader program
+ * and vertex buffers. Should be called in
+ * \fn initializeGL() once. Series of one context can
+ * share program, e.g. panels of \class PlotCanvas, then
+ * it's bound once for all of them.
+ */
+void RenderSeries::initSeriesRender(GLState *glstate, GLuint program)
+{
+  initializeOpenGLFunctions();
+  state = glstate;
+
+  ownProgram = (program == 0);
+  series_prog = ownProgram ? createShaderProgram(this, vertexShaderSeries, fragmentShaderSeries) : program;
+  series_matrix = glGetUniformLocation(series_prog, "ModelViewProjectionMatrix");
+
+  glGenBuffers(1, &series_VBO);
+  glGenVertexArrays(1, &series_VAO);
+
+  glBindVertexArray(series_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, series_VBO);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  state->invalidate();
+}
+
+
+/*!
+ * \brief RenderSeries::releaseSeriesRender
+ *
+ * Delete vertex buffers and program, if it's not shared.
+ * Should be called with current context.
+ */
+void RenderSeries::releaseSeriesRender()
+{
+  if(series_VAO == 0)
+    return;
+
+  glDeleteBuffers(1, &series_VBO);
+  glDeleteVertexArrays(1, &series_VAO);
+  if(ownProgram)
+    glDeleteProgram(series_prog);
+  series_VBO = 0;
+  series_VAO = 0;
+  series_prog = 0;
+  state->invalidate();
+}
+
+
+/*!
+ * \brief RenderSeries::setData
+ * \param x sample positions, sorted ascending
+ * \param y sample values
+ * \param size number of samples
+ * \param summary [min | max] of values per chunk of
+ *    \param chunkSamples samples, can be null
+ * \param chunkSamples power of PYRAMID_FACTOR
+ *
+ * Arrays are not copied, they should live as long as the
+ * renderer uses them, e.g. vectors of \class Plot or columns
+ * of \class MappedDataset. Min/max pyramid is seeded from
+ * \param summary if it's given, so samples aren't read until
+ * they are drawn, otherwise it's built from scratch.
+ */
+void RenderSeries::setData(const double *x, const double *y, size_t size,
+                           const double *summary, size_t chunkSamples)
+{
+  dataX = x;
+  dataY = y;
+  dataSize = size;
+  if((summary == nullptr) || !pyramid.seed(dataY, dataSize, summary, chunkSamples))
+    pyramid.build(dataY, dataSize);
+  dirty = true;
+}
+
+
+/*!
+ * \brief RenderSeries::appendData
+ * \param x sample positions, the same samples as before and the new ones
+ * \param y sample values
+ * \param size number of samples
+ *
+ * Call after samples were appended to arrays passed to
+ * \fn setData(), they may have been reallocated since.
+ * Only new nodes are added to the pyramid.
+ */
+void RenderSeries::appendData(const double *x, const double *y, size_t size)
+{
+  if((dataX == nullptr) || (dataY == nullptr))
+    return;
+
+  dataX = x;
+  dataY = y;
+  dataSize = size;
+  pyramid.append(dataY, dataSize);
+  dirty = true;
+}
+
+
+/*!
+ * \brief RenderSeries::dataRange
+ * \param min the lowest value of series
+ * \param max the highest value of series
+ * \return false if series is empty
+ *
+ * Read from the pyramid, so it costs a few
+ * nodes even for series of mapped file.
+ */
+bool RenderSeries::dataRange(double *min, double *max)
+{
+  if((dataY == nullptr) || (dataSize == 0))
+    return false;
+
+  pyramid.range(dataY, 0, dataSize, min, max);
+  return true;
+}
+
+
+/*!
+ * \brief RenderSeries::setView
+ * \param vw range of values where series is drawn
+ * \param pr projection matrix values
+ * \param cols number of pixel columns in \param vw
+ *
+ * Call after resize events, series is decimated
+ * to \param cols columns on the next render.
+ */
+void RenderSeries::setView(Proj &vw, Proj &pr, int cols)
+{
+  view = vw;
+  proj = pr;
+  columns = cols;
+  dirty = true;
+}
+
+
+/*!
+ * \brief RenderSeries::setClip
+ * \param x left edge of view in framebuffer pixels
+ * \param y bottom edge of view in framebuffer pixels
+ * \param width
+ * \param height
+ *
+ * Series is scissored to view, so it's
+ * not painted over text of axes.
+ */
+void RenderSeries::setClip(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  clip.x = x;
+  clip.y = y;
+  clip.width = width;
+  clip.height = height;
+}
+
+
+/*!
+ * \brief RenderSeries::updateShaderMatrix
+ *
+ * Matrix is only kept here and loaded to
+ * shaders on every render. Vertices are
+ * relative to the left edge of view, so
+ * is the matrix, see \fn MinMaxPyramid::decimate().
+ */
+void RenderSeries::updateShaderMatrix()
+{
+  Proj shifted = proj;
+  shifted.left -= view.left;
+  shifted.right -= view.left;
+  orthoMatrix(shifted, projMatrix);
+}
+
+
+/*!
+ * \brief RenderSeries::updateVertices
+ *
+ * Decimate samples in view to pixel columns
+ * and load them to vertex buffer object.
+ */
+void RenderSeries::updateVertices()
+{
+  TRACE_ZONE("decimate");
+  if((dataX == nullptr) || (dataY == nullptr))
+    vertices.clear();
+  else
+    pyramid.decimate(dataX, dataY, dataSize, view.left, view.right, columns, vertices);
+
+  state->bindArrayBuffer(series_VBO);
+  glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), vertices.data(), GL_DYNAMIC_DRAW);
+  state->countUpload(vertices.size() * sizeof(GLfloat));
+
+  dirty = false;
+}
+
+
+/*!
+ * \brief RenderSeries::renderSeries
+ *
+ * Draw series as a polyline. Should be called in
+ * \fn paintGL() or any other paint event.
+ */
+void RenderSeries::renderSeries()
+{
+  TRACE_ZONE("draw series");
+  if(dirty)
+    updateVertices();
+
+  if(vertices.size() < 4)
+    return;
+
+  state->setScissor(true);
+  glScissor(clip.x, clip.y, clip.width, clip.height);
+
+  state->useProgram(series_prog);
+  glUniformMatrix4fv(series_matrix, 1, GL_FALSE, &projMatrix[0][0]);
+  state->bindVertexArray(series_VAO);
+  glDrawArrays(GL_LINE_STRIP, 0, vertices.size() / 2);
+  state->countDraw();
+  state->setScissor(false);
+}
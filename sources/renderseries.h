@@ -0,0 +1,70 @@
+#ifndef RENDERSERIES_H
+#define RENDERSERIES_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <vector>
+
+#include "shaderprogram.h"
+#include "glstate.h"
+#include "minmaxpyramid.h"
+
+
+extern const char *vertexShaderSeries;
+extern const char *fragmentShaderSeries;
+
+
+class RenderSeries : protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  explicit RenderSeries();
+  ~RenderSeries();
+
+  void initSeriesRender(GLState *glstate, GLuint program = 0);
+  void releaseSeriesRender();
+  inline GLuint getProgram();
+
+  void setData(const double *x, const double *y, size_t size,
+               const double *summary = nullptr, size_t chunkSamples = 0);
+  void appendData(const double *x, const double *y, size_t size);
+  bool dataRange(double *min, double *max);
+
+  void setView(Proj &vw, Proj &pr, int columns);
+  void setClip(GLint x, GLint y, GLsizei width, GLsizei height);
+  void updateShaderMatrix();
+  void renderSeries();
+
+private:
+  void updateVertices();
+
+  MinMaxPyramid pyramid;
+  const double *dataX;     ///< Sample positions, sorted ascending
+  const double *dataY;     ///< Sample values
+  size_t dataSize;         ///< Number of samples in \var dataX and \var dataY
+
+  Proj view;               ///< Range of values where series is drawn
+  Proj proj;               ///< Holds projection matrix values, the same as \class RenderText has
+  Clip clip;               ///< Part of widget in pixels series is clipped to
+  int columns;             ///< Number of pixel columns in view
+
+  std::vector<GLfloat> vertices;      ///< Decimated polyline, [x - view.left | y] pairs
+  bool dirty;              ///< Vertices should be decimated again before render
+
+  GLState *state;          ///< Bindings of widget context, shared with other renderers
+  GLfloat projMatrix[4][4];   ///< Orthographic matrix of \var proj shifted by left edge of view, loaded before every render, since program can be shared
+  GLuint series_prog;      ///< Shader program that used to render polyline
+  bool ownProgram;         ///< \var series_prog was compiled by this renderer, not passed to \fn initSeriesRender()
+  GLint series_matrix;     ///< Location of projection matrix uniform, resolved once after link
+  GLuint series_VBO;       ///< Vertex buffer object that holds polyline vertices
+  GLuint series_VAO;       ///< Vertex array object used to load values to compiled shader program
+};
+
+
+inline GLuint RenderSeries::getProgram()
+{
+  return series_prog;
+}
+
+
+#endif // RENDERSERIES_H
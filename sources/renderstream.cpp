@@ -0,0 +1,248 @@
+#include "renderstream.h"
+#include "renderseries.h"
+#include "tracezones.h"
+#include <algorithm>
+
+
+RenderStream::RenderStream()
+{
+  stream = nullptr;
+  uploaded = 0;
+  oldest = 0;
+  origin = 0;
+  latest = 0;
+  clip.x = 0;
+  clip.y = 0;
+  clip.width = 0;
+  clip.height = 0;
+  state = nullptr;
+  stream_prog = 0;
+  stream_matrix = -1;
+  stream_VBO = 0;
+  stream_VAO = 0;
+}
+
+
+RenderStream::~RenderStream()
+{
+
+}
+
+
+/*!
+ * \brief RenderStream::initStreamRender
+ * \param buffer ring filled by producer thread
+ * \param glstate bindings tracker of widget context
+ *
+ * Initialize OpenGL functions, create shader program
+ * and ring vertex buffer of the same capacity as
+ * \param buffer has. Should be called in
+ * \fn initializeGL() once.
+ */
+void RenderStream::initStreamRender(StreamBuffer *buffer, GLState *glstate)
+{
+  initializeOpenGLFunctions();
+  state = glstate;
+
+  stream = buffer;
+  uploaded = 0;
+  oldest = 0;
+
+  stream_prog = createShaderProgram(this, vertexShaderSeries, fragmentShaderSeries);
+  stream_matrix = glGetUniformLocation(stream_prog, "ModelViewProjectionMatrix");
+
+  glGenBuffers(1, &stream_VBO);
+  glGenVertexArrays(1, &stream_VAO);
+
+  glBindVertexArray(stream_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, stream_VBO);
+
+  glBufferData(GL_ARRAY_BUFFER, (stream->capacity() + 1) * 2 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), 0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(0);
+  state->invalidate();
+}
+
+
+/*!
+ * \brief RenderStream::updateStream
+ * \return true if new samples arrived
+ *
+ * Copy samples written since the last call from the
+ * ring and load only them to vertex buffer. Once per
+ * round of the ring all samples are loaded again with
+ * a new origin, so it's still O(1) per sample.
+ * Should be called with current OpenGL context.
+ */
+bool RenderStream::updateStream()
+{
+  TRACE_ZONE("upload stream");
+  if(stream == nullptr)
+    return false;
+
+  size_t head = stream->written();
+  if(head == uploaded)
+    return false;
+
+  size_t cap = stream->capacity();
+  size_t from = uploaded;
+  bool rebase = (uploaded == 0) || (head / cap != uploaded / cap);
+  if(rebase)
+    {
+      from = (head > cap) ? head - cap : 0;
+    }
+
+  stageX.resize(head - from);
+  stageY.resize(head - from);
+  size_t valid = stream->read(from, head, stageX.data(), stageY.data());
+
+  if(rebase || (valid > from))
+    oldest = valid;
+  if(head > cap + oldest)
+    oldest = head - cap;
+
+  if(rebase && (valid < head))
+    origin = stageX[valid - from];
+
+  vertices.resize((head - valid) * 2);
+  for(size_t i = valid; i < head; i++)
+    {
+      vertices[(i - valid) * 2] = stageX[i - from] - origin;
+      vertices[(i - valid) * 2 + 1] = stageY[i - from];
+    }
+
+  uploadRange(valid, head);
+
+  uploaded = head;
+  if(valid < head)
+    latest = stageX.back();
+  return true;
+}
+
+
+/*!
+ * \brief RenderStream::uploadRange
+ * \param from index of the first sample in \var vertices
+ * \param to index after the last one
+ *
+ * Samples go to ring slots, range is split in two
+ * at the end of the ring. First slot is also copied
+ * after the last one, so line strip goes round the ring.
+ */
+void RenderStream::uploadRange(size_t from, size_t to)
+{
+  size_t cap = stream->capacity();
+
+  state->bindArrayBuffer(stream_VBO);
+  size_t i = from;
+  while(i < to)
+    {
+      size_t slot = i % cap;
+      size_t run = std::min(to - i, cap - slot);
+      glBufferSubData(GL_ARRAY_BUFFER, slot * 2 * sizeof(GLfloat), run * 2 * sizeof(GLfloat),
+                      &vertices[(i - from) * 2]);
+      state->countUpload(run * 2 * sizeof(GLfloat));
+      if(slot == 0)
+        {
+          glBufferSubData(GL_ARRAY_BUFFER, cap * 2 * sizeof(GLfloat), 2 * sizeof(GLfloat),
+                          &vertices[(i - from) * 2]);
+          state->countUpload(2 * sizeof(GLfloat));
+        }
+      i += run;
+    }
+}
+
+
+/*!
+ * \brief RenderStream::setView
+ * \param pr projection matrix values
+ */
+void RenderStream::setView(Proj &pr)
+{
+  proj = pr;
+}
+
+
+/*!
+ * \brief RenderStream::setClip
+ * \param x left edge of view in framebuffer pixels
+ * \param y bottom edge of view in framebuffer pixels
+ * \param width
+ * \param height
+ *
+ * Stream is scissored to view, so it's
+ * not painted over text of axes.
+ */
+void RenderStream::setClip(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+  clip.x = x;
+  clip.y = y;
+  clip.width = width;
+  clip.height = height;
+}
+
+
+/*!
+ * \brief RenderStream::updateShaderMatrix
+ *
+ * Vertices are relative to \var origin, so is the matrix.
+ * Call after \fn updateStream(), origin could be changed.
+ */
+void RenderStream::updateShaderMatrix()
+{
+  if(stream == nullptr)
+    return;
+
+  Proj shifted = proj;
+  shifted.left -= origin;
+  shifted.right -= origin;
+
+  GLfloat proj_matrix[4][4];
+  orthoMatrix(shifted, proj_matrix);
+
+  state->useProgram(stream_prog);
+  glUniformMatrix4fv(stream_matrix, 1, GL_FALSE, &proj_matrix[0][0]);
+}
+
+
+/*!
+ * \brief RenderStream::renderStream
+ *
+ * Draw ring from the oldest sample to the newest one,
+ * at most two line strips. Should be called in
+ * \fn paintGL() or any other paint event.
+ */
+void RenderStream::renderStream()
+{
+  TRACE_ZONE("draw stream");
+  if(stream == nullptr)
+    return;
+
+  size_t count = uploaded - oldest;
+  if(count < 2)
+    return;
+
+  size_t cap = stream->capacity();
+  size_t start = oldest % cap;
+
+  state->setScissor(true);
+  glScissor(clip.x, clip.y, clip.width, clip.height);
+
+  state->useProgram(stream_prog);
+  state->bindVertexArray(stream_VAO);
+  if(start + count <= cap)
+    {
+      glDrawArrays(GL_LINE_STRIP, start, count);
+      state->countDraw();
+    }
+  else
+    {
+      glDrawArrays(GL_LINE_STRIP, start, cap + 1 - start);
+      glDrawArrays(GL_LINE_STRIP, 0, start + count - cap);
+      state->countDraw(2);
+    }
+  state->setScissor(false);
+}
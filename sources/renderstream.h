@@ -0,0 +1,61 @@
+#ifndef RENDERSTREAM_H
+#define RENDERSTREAM_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include <vector>
+
+#include "shaderprogram.h"
+#include "glstate.h"
+#include "streambuffer.h"
+
+
+class RenderStream : protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  explicit RenderStream();
+  ~RenderStream();
+
+  void initStreamRender(StreamBuffer *buffer, GLState *glstate);
+  bool updateStream();
+
+  void setView(Proj &pr);
+  void setClip(GLint x, GLint y, GLsizei width, GLsizei height);
+  void updateShaderMatrix();
+  void renderStream();
+
+  inline double lastX();
+
+private:
+  void uploadRange(size_t from, size_t to);
+
+  StreamBuffer *stream;    ///< Ring filled by producer thread
+
+  size_t uploaded;         ///< Number of samples loaded to vertex buffer
+  size_t oldest;           ///< First sample in vertex buffer that is valid
+  double origin;           ///< Position subtracted from vertices, so floats don't lose precision
+  double latest;           ///< Position of the newest sample
+
+  std::vector<double> stageX;         ///< New samples copied from ring
+  std::vector<double> stageY;
+  std::vector<GLfloat> vertices;      ///< New samples, [x - origin | y] pairs
+
+  Proj proj;               ///< Holds projection matrix values, the same as \class RenderText has
+  Clip clip;               ///< Part of widget in pixels stream is clipped to
+
+  GLState *state;          ///< Bindings of widget context, shared with other renderers
+  GLuint stream_prog;      ///< Shader program that used to render polyline
+  GLint stream_matrix;     ///< Location of projection matrix uniform, resolved once after link
+  GLuint stream_VBO;       ///< Ring vertex buffer object, one slot per sample and a copy of the first slot
+  GLuint stream_VAO;       ///< Vertex array object used to load values to compiled shader program
+};
+
+
+inline double RenderStream::lastX()
+{
+  return latest;
+}
+
+
+#endif // RENDERSTREAM_H
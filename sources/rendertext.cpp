@@ -1,113 +1,697 @@
 #include "rendertext.h"
+#include "tracezones.h"
 #include <iostream>
 #include <math.h>
+#include <stddef.h>
+#include <algorithm>
 #include <QPainter>
 
-#define MAX_CH 7
+#define LAYER_STATIC_FRAMES 3     ///< Unchanged renders before layer is cached in texture
+#define LABEL_SLOT_VERTICES (LABEL_SLOT_GLYPHS * 6)
+#define LABEL_MIN_SLOTS 16        ///< Slots \var label_VBO is created with
+#define LAYER_BUFFER_BYTES (sizeof(GLfloat) * 4 * 6 * 2)   ///< Size of \var layer_VBO, quad per layer
+
+
+TextMemory RenderText::allRenderers = TextMemory();
+
+
+/*!
+ * \brief moveUsage
+ * \param total sum of usages
+ * \param from usage counted in \param total so far
+ * \param to usage counted instead of it
+ */
+static void moveUsage(TextMemory &total, const TextMemory &from, const TextMemory &to)
+{
+  total.labelBytes += to.labelBytes - from.labelBytes;
+  total.layoutBytes += to.layoutBytes - from.layoutBytes;
+  total.matrixBytes += to.matrixBytes - from.matrixBytes;
+  total.bufferBytes += to.bufferBytes - from.bufferBytes;
+  total.layerBytes += to.layerBytes - from.layerBytes;
+  total.atlasBytes += to.atlasBytes - from.atlasBytes;
+  total.cpuBytes += to.cpuBytes - from.cpuBytes;
+  total.gpuBytes += to.gpuBytes - from.gpuBytes;
+}
 
 
 const char *vertexShaderText =
     "#version 330 core\n"
     "layout (location = 0) in vec4 vertex;\n"
+    "layout (location = 1) in vec4 color;\n"
+    "layout (location = 2) in float layer;\n"
+    "layout (location = 3) in vec2 offset;\n"
+    "layout (location = 4) in float angle;\n"
     "uniform mat4 ModelViewProjectionMatrix;\n"
-    "out vec2 TexCoord;\n"
+    "uniform vec2 PixelScale;\n"
+    "out vec3 TexCoord;\n"
+    "out vec4 TextColor;\n"
+    "flat out int Rotated;\n"
     "void main()\n"
     " {\n"
+    "   float turn = angle * 6.2831853;\n"
+    "   mat2 rotation = mat2(cos(turn), sin(turn), -sin(turn), cos(turn));\n"
     "   gl_Position = ModelViewProjectionMatrix * vec4(vertex.xy, 0.0, 1.0);\n"
-    "   TexCoord = vertex.zw;\n"
+    "   gl_Position.xy += rotation * offset * PixelScale;\n"
+    "   TexCoord = vec3(vertex.zw, layer);\n"
+    "   TextColor = color;\n"
+    "   Rotated = (angle != 0.0) ? 1 : 0;\n"
     " }\n";
 
 
+// glyphs of rotated text don't line up with pixels, so atlas
+// is filtered by hand there, unrotated text stays crisp;
+// taps are clamped to cell of the glyph, so edge of
+// the neighbouring glyph doesn't bleed in
 const char *fragmentShaderText =
+    "#version 330 core\n"
+    "in vec3 TexCoord;\n"
+    "in vec4 TextColor;\n"
+    "flat in int Rotated;\n"
+    "out vec4 Color;\n"
+    "uniform sampler2DArray text;\n"
+    "uniform int Cells;\n"
+    "float texel(ivec2 pos, ivec2 first, ivec2 last, int layer)\n"
+    " {\n"
+    "   return texelFetch(text, ivec3(clamp(pos, first, last), layer), 0).r;\n"
+    " }\n"
+    "void main()\n"
+    " {\n"
+    "   float alpha;\n"
+    "   if(Rotated == 0)\n"
+    "     alpha = texture(text, TexCoord).r;\n"
+    "   else\n"
+    "    {\n"
+    "     ivec2 size = textureSize(text, 0).xy;\n"
+    "     int cellWidth = size.x / Cells;\n"
+    "     ivec2 first = ivec2(min(int(TexCoord.x * float(Cells)), Cells - 1) * cellWidth, 0);\n"
+    "     ivec2 last = ivec2(first.x + cellWidth - 1, size.y - 1);\n"
+    "     vec2 pos = TexCoord.xy * vec2(size) - 0.5;\n"
+    "     ivec2 base = ivec2(floor(pos));\n"
+    "     vec2 f = fract(pos);\n"
+    "     int layer = int(TexCoord.z + 0.5);\n"
+    "     alpha = mix(mix(texel(base, first, last, layer), texel(base + ivec2(1, 0), first, last, layer), f.x),\n"
+    "                 mix(texel(base + ivec2(0, 1), first, last, layer), texel(base + ivec2(1, 1), first, last, layer), f.x), f.y);\n"
+    "    }\n"
+    "   Color = vec4(TextColor.rgb, TextColor.a * alpha);\n"
+    " }\n";
+
+
+const char *vertexShaderLayer =
+    "#version 330 core\n"
+    "layout (location = 0) in vec4 vertex;\n"
+    "out vec2 TexCoord;\n"
+    "void main()\n"
+    " {\n"
+    "   gl_Position = vec4(vertex.xy, 0.0, 1.0);\n"
+    "   TexCoord = vertex.zw;\n"
+    " }\n";
+
+
+const char *fragmentShaderLayer =
     "#version 330 core\n"
     "in vec2 TexCoord;\n"
     "out vec4 Color;\n"
-    "uniform sampler2D text;\n"
-    "vec3 textColor = vec3(0.0, 0.0, 0.0);\n"
+    "uniform sampler2D layer;\n"
     "void main()\n"
     " {\n"
-    "   vec4 sampled = vec4(0.0, 0.0, 0.0, texture(text, TexCoord).r);\n"
-    "   Color = vec4(textColor, 1.0) * sampled;\n"
+    "   Color = texture(layer, TexCoord);\n"
     " }\n";
 
 
 RenderText::RenderText()
 {
-  textHeight = 0;
-  textMaxWidth = 0;
+  state = nullptr;
+  text_VBO = 0;
+  text_VAO = 0;
+  layer_VBO = 0;
+  layer_VAO = 0;
+  label_VBO = 0;
+  label_VAO = 0;
+  matrix_VBO = 0;
+  matrix_VAO = 0;
+  matrixBufferSlots = 0;
+  labelBufferSlots = 0;
+  labelsRelayout = true;
+  labelPixelWidth = 0;
+  labelPixelHeight = 0;
+  streamDirty = true;
+  batchLoaded = false;
+  for(int i = 0; i < 2; i++)
+    {
+      layers[i].first = 0;
+      layers[i].count = 0;
+      layers[i].version = 0;
+      layers[i].changed = true;
+      layers[i].stableFrames = 0;
+      layers[i].cached = false;
+      layers[i].fbo = 0;
+      layers[i].texture = 0;
+      layers[i].texWidth = 0;
+      layers[i].texHeight = 0;
+    }
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      projMatrix[i][j] = (i == j) ? 1 : 0;
+  frame = nullptr;
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      frameMatrix[i][j] = (i == j) ? 1 : 0;
+  plotArea.left = 0;
+  plotArea.right = 0;
+  plotArea.bottom = 0;
+  plotArea.top = 0;
+  deviceScale = 1;
+  originX = 0;
+  originY = 0;
+  originPixelWidth = 0;
+  originPixelHeight = 0;
+  atlasKey = -1;
+  atlasTexture = 0;
+  labelTextBytes = 0;
+  textBufferBytes = 0;
+  cpuBudget = 0;
+  gpuBudget = 0;
+  cpuCompacted = 0;
+  gpuCompacted = 0;
+  budgetDirty = true;
+  compactLayout = false;
+  layerCaching = true;
+  reported = TextMemory();
 }
 
 
 RenderText::~RenderText()
 {
-
+  moveUsage(allRenderers, reported, TextMemory());
 }
 
 
 /*!
  * \brief RenderText::initTextRender
+ * \param glstate bindings tracker of widget context
+ * \param frameReady called on worker thread when laid out
+ *    labels are ready, e.g. to schedule repaint
  *
  * Initialize OpenGL functions, create shader program
  * and generate text textures. Should be called in
  * \fn initializeGL() once.
+ * Program, texture atlas and glyph metrics are created
+ * only by the first widget of context share group, the
+ * others take them from \class TextResources. Only vertex
+ * buffers are created for each widget. Cached label
+ * layers are sampled from texture unit 1, so the atlas
+ * stays bound to unit 0. Labels added with \fn addLabel()
+ * before this call are laid out at the first render.
+ * Device pixel ratio should be set before, so the first
+ * atlas is rasterized for it, see \fn setDevicePixelRatio().
  */
-void RenderText::initTextRender()
+void RenderText::initTextRender(GLState *glstate, std::function<void()> frameReady)
 {
   initializeOpenGLFunctions();
+  state = glstate;
+  repaint = frameReady;
 
   glEnable(GL_CULL_FACE);
   glEnable(GL_BLEND);
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-  text_prog = createShader(vertexShaderText, fragmentShaderText);
-  glUseProgram(text_prog);
+  shared = TextResources::acquire();
+  if(!shared->ready)
+    {
+      shared->text_prog = createShader(vertexShaderText, fragmentShaderText);
+      shared->text_matrix = glGetUniformLocation(shared->text_prog, "ModelViewProjectionMatrix");
+      shared->text_pixel = glGetUniformLocation(shared->text_prog, "PixelScale");
+      shared->layer_prog = createShader(vertexShaderLayer, fragmentShaderLayer);
+      glUseProgram(shared->layer_prog);
+      glUniform1i(glGetUniformLocation(shared->layer_prog, "layer"), 1);
+      glUseProgram(0);
+      genTextures();
+      // every atlas has the same number of cells, only their size differs
+      glUseProgram(shared->text_prog);
+      glUniform1i(glGetUniformLocation(shared->text_prog, "Cells"), shared->texAtlas.cols);
+      glUseProgram(0);
+      shared->ready = true;
+    }
 
-  genTextures();
+  metrics.setCharacterSize(shared->characterWidth, shared->characterHeight);
 
-  glGenBuffers(1, &text_VBO);
-  glGenVertexArrays(1, &text_VAO);
+  builder.reset(new FrameBuilder());
+  builder->start(shared->Characters, shared->characterWidth, shared->characterHeight,
+                 shared->texAtlas.colFactor, frameReady);
+  labelLayout.setGlyphs(shared->Characters, shared->characterWidth, shared->characterHeight,
+                        shared->texAtlas.colFactor);
+  labelsRelayout = true;
 
-  glBindVertexArray(text_VAO);
-  glBindBuffer(GL_ARRAY_BUFFER, text_VBO);
+  createGlyphArray(text_VBO, text_VAO);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphVertex) * 6, NULL, GL_DYNAMIC_DRAW);
+  createGlyphArray(label_VBO, label_VAO);
+  labelBufferSlots = 0;
+  matrixLabels.setGlyphs(shared->Characters, shared->characterWidth, shared->characterHeight,
+                         shared->texAtlas.colFactor);
+  createGlyphArray(matrix_VBO, matrix_VAO);
+  matrixBufferSlots = 0;
 
-  glBufferData(GL_ARRAY_BUFFER, sizeof(GLdouble) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+  glGenBuffers(1, &layer_VBO);
+  glGenVertexArrays(1, &layer_VAO);
+
+  glBindVertexArray(layer_VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, layer_VBO);
+
+  glBufferData(GL_ARRAY_BUFFER, LAYER_BUFFER_BYTES, NULL, GL_DYNAMIC_DRAW);
 
   glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 4, GL_DOUBLE, GL_FALSE, 4 * sizeof(GLdouble), 0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), 0);
   glBindBuffer(GL_ARRAY_BUFFER, 0);
   glBindVertexArray(0);
+  state->invalidate();
+}
+
+
+/*!
+ * \brief RenderText::createGlyphArray
+ * \param vbo vertex buffer object to generate
+ * \param vao vertex array object to generate, reads \struct GlyphVertex from \param vbo
+ *
+ * Both are left bound.
+ */
+void RenderText::createGlyphArray(GLuint &vbo, GLuint &vao)
+{
+  glGenBuffers(1, &vbo);
+  glGenVertexArrays(1, &vao);
+
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+  glEnableVertexAttribArray(0);
+  glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(GlyphVertex), 0);
+  glEnableVertexAttribArray(1);
+  glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(GlyphVertex),
+                        reinterpret_cast<void *>(offsetof(GlyphVertex, color)));
+  glEnableVertexAttribArray(2);
+  glVertexAttribPointer(2, 1, GL_UNSIGNED_BYTE, GL_FALSE, sizeof(GlyphVertex),
+                        reinterpret_cast<void *>(offsetof(GlyphVertex, layer)));
+  glEnableVertexAttribArray(3);
+  glVertexAttribPointer(3, 2, GL_SHORT, GL_FALSE, sizeof(GlyphVertex),
+                        reinterpret_cast<void *>(offsetof(GlyphVertex, dx)));
+  glEnableVertexAttribArray(4);
+  glVertexAttribPointer(4, 1, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(GlyphVertex),
+                        reinterpret_cast<void *>(offsetof(GlyphVertex, angle)));
+}
+
+
+/*!
+ * \brief RenderText::releaseTextRender
+ *
+ * Delete vertex buffers of the widget and release
+ * shared resources. Should be called with current
+ * context, e.g. in widget destructor after \fn makeCurrent().
+ */
+void RenderText::releaseTextRender()
+{
+  if(!shared)
+    return;
+
+  builder.reset();
+  frame = nullptr;
+  if(atlasKey >= 0)
+    shared->atlases[atlasKey].users--;
+  atlasKey = -1;
+  atlasTexture = 0;
+  textBufferBytes = 0;
+
+  glDeleteBuffers(1, &text_VBO);
+  glDeleteVertexArrays(1, &text_VAO);
+  glDeleteBuffers(1, &layer_VBO);
+  glDeleteVertexArrays(1, &layer_VAO);
+  glDeleteBuffers(1, &label_VBO);
+  glDeleteVertexArrays(1, &label_VAO);
+  glDeleteBuffers(1, &matrix_VBO);
+  glDeleteVertexArrays(1, &matrix_VAO);
+  matrixBufferSlots = 0;
+  matrixLabels.touchAll();
+  labelBufferSlots = 0;
+  labelsRelayout = true;
+  batchLoaded = false;
+  for(int i = 0; i < 2; i++)
+    {
+      if(layers[i].fbo != 0)
+        {
+          glDeleteFramebuffers(1, &layers[i].fbo);
+          glDeleteTextures(1, &layers[i].texture);
+          layers[i].fbo = 0;
+          layers[i].texture = 0;
+          layers[i].texWidth = 0;
+          layers[i].texHeight = 0;
+        }
+      layers[i].cached = false;
+    }
+  state->invalidate();
+  shared.reset();
+  account();
 }
 
 
 /*!
  * \brief RenderText::renderText
  *
+ * Render chrome and labels of axes and then retained
+ * labels over them. Should be called in \fn paintGL() or
+ * any other paint event. To put data between them, call
+ * \fn renderChrome() and \fn renderLabels() instead.
+ */
+void RenderText::renderText()
+{
+  renderChrome();
+  renderLabels();
+}
+
+
+/*!
+ * \brief RenderText::renderChrome
+ *
+ * Frame of plot area, ticks, grid lines and labels of
+ * axes are one vertex stream, see \fn TextLayout::placeChrome(),
+ * so the whole decoration of plot is one upload and one
+ * draw call, or a cached layer per axis.
  * Attach compiled shader program, bind texture with rendered glyphs,
  * bind vertex buffer object where we pack screen and
  * texture coordinates. Should be called in \fn paintGL() or
- * any other paint event.
+ * any other paint event. Bindings go through \class GLState
+ * and are left as they are, so the next render of the
+ * same widget doesn't bind them again.
+ *
+ * Labels are laid out on worker thread, the newest finished
+ * frame is taken here and loaded to vertex buffer, with the
+ * matrix it was laid out for, so text of one frame is always
+ * consistent. Labels of each axis are a layer. Layer that didn't change
+ * for LAYER_STATIC_FRAMES renders is drawn once to its own
+ * texture and then put on screen with one quad. Layers that
+ * change every frame, e.g. scrolled axis in stream mode,
+ * are drawn from glyph quads, all of them in one call.
  */
-void RenderText::renderText()
+void RenderText::renderChrome()
 {
+  TRACE_ZONE("draw chrome");
+  if(!shared)
+    return;
+  selectAtlas();
+  checkBudget();
 
-  glUseProgram(text_prog);
-  glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(text_VAO);
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glBindTexture(GL_TEXTURE_2D, Texture);
-  glBindBuffer(GL_ARRAY_BUFFER, text_VBO);
-  for(uint i = 0; i < textBoxes.size(); i++)
+  if(builder && builder->acquire())
     {
-      glBufferData(GL_ARRAY_BUFFER, textBoxes[i].pos.size() * sizeof(GLdouble),
-                   textBoxes[i].pos.data(), GL_DYNAMIC_DRAW);
-      glDrawArrays(GL_TRIANGLES, 0, textBoxes[i].pos.size()/4);
+      frame = &builder->frame();
+      budgetDirty = true;
+      Proj shifted = frame->proj;
+      shifted.left -= frame->originX;
+      shifted.right -= frame->originX;
+      shifted.bottom -= frame->originY;
+      shifted.top -= frame->originY;
+      orthoMatrix(shifted, frameMatrix);
+      for(int i = 0; i < 2; i++)
+        {
+          layers[i].first = frame->first[i];
+          layers[i].count = frame->count[i];
+          if(layers[i].version != frame->version[i])
+            {
+              layers[i].version = frame->version[i];
+              layers[i].changed = true;
+            }
+        }
+      streamDirty = true;
     }
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glBindVertexArray(0);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glUseProgram(0);
-  glDisableClientState(GL_VERTEX_ARRAY);
 
+  if(frame == nullptr)
+    return;
+
+  if(streamDirty)
+    uploadFrame();
+
+  state->useProgram(shared->text_prog);
+  glUniformMatrix4fv(shared->text_matrix, 1, GL_FALSE, &frameMatrix[0][0]);
+  state->bindTexture(GL_TEXTURE0, atlasTexture, GL_TEXTURE_2D_ARRAY);
+  state->bindVertexArray(text_VAO);
+
+  GLint first[2];
+  GLsizei count[2];
+  GLsizei direct = 0;
+  bool composite = false;
+  for(int i = 0; i < 2; i++)
+    {
+      Layer &layer = layers[i];
+      if(layer.changed)
+        {
+          layer.changed = false;
+          layer.cached = false;
+          layer.stableFrames = 0;
+        }
+      else if(layer.stableFrames < LAYER_STATIC_FRAMES)
+        {
+          layer.stableFrames++;
+        }
+
+      if(layer.count == 0)
+        continue;
+
+      if((layer.stableFrames < LAYER_STATIC_FRAMES) || !layerCaching)
+        {
+          first[direct] = layer.first;
+          count[direct] = layer.count;
+          direct++;
+          continue;
+        }
+
+      if(!layer.cached)
+        cacheLayer(layer, i);
+      composite = true;
+    }
+
+  if(direct > 0)
+    {
+      glMultiDrawArrays(GL_TRIANGLES, first, count, direct);
+      state->countDraw();
+    }
+
+  if(!composite)
+    return;
+
+  // layers hold premultiplied colors
+  glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  state->useProgram(shared->layer_prog);
+  state->bindVertexArray(layer_VAO);
+  for(int i = 0; i < 2; i++)
+    {
+      if(!layers[i].cached || (layers[i].count == 0))
+        continue;
+      state->bindTexture(GL_TEXTURE1, layers[i].texture);
+      glDrawArrays(GL_TRIANGLES, i * 6, 6);
+      state->countDraw();
+    }
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+
+
+/*!
+ * \brief RenderText::uploadFrame
+ *
+ * Load glyph quads of the current frame
+ * to vertex buffer.
+ */
+void RenderText::uploadFrame()
+{
+  TRACE_ZONE("upload frame");
+  state->bindArrayBuffer(text_VBO);
+  glBufferData(GL_ARRAY_BUFFER, frame->vertices.size() * sizeof(GlyphVertex),
+               frame->vertices.data(), GL_DYNAMIC_DRAW);
+  state->countUpload(frame->vertices.size() * sizeof(GlyphVertex));
+  if(textBufferBytes != frame->vertices.size() * sizeof(GlyphVertex))
+    {
+      textBufferBytes = frame->vertices.size() * sizeof(GlyphVertex);
+      budgetDirty = true;
+    }
+  streamDirty = false;
+  batchLoaded = false;
+}
+
+
+/*!
+ * \brief RenderText::renderBatch
+ * \param vertices glyph quads and chrome in values of
+ *    projection matrix, see \fn setProjMatrix()
+ * \param changed \param vertices differ from the last call
+ * \param loaded leading vertices that are the same as in
+ *    the last call, e.g. when caller only appended rows
+ *
+ * Render text laid out by caller, e.g. labels and chrome
+ * of all panels of \class PlotCanvas, in one upload and
+ * one draw call. Vertices are loaded only when they
+ * changed or vertex buffer was used for something else
+ * since, so a still batch costs one draw. Vertex buffer
+ * is as large as capacity of \param vertices, so appended
+ * ones that fit are loaded alone, after \param loaded.
+ * Shares vertex buffer with \fn renderChrome(), widget
+ * should use one of them.
+ */
+void RenderText::renderBatch(const std::vector<GlyphVertex> &vertices, bool changed, size_t loaded)
+{
+  TRACE_ZONE("draw batch");
+  if(!shared || vertices.empty())
+    return;
+  selectAtlas();
+  checkBudget();
+
+  if(changed || !batchLoaded)
+    {
+      TRACE_ZONE("upload batch");
+      state->bindArrayBuffer(text_VBO);
+      size_t from = loaded;
+      if(!batchLoaded || (from > vertices.size()) || (textBufferBytes < vertices.size() * sizeof(GlyphVertex)))
+        {
+          from = 0;
+          if(textBufferBytes != vertices.capacity() * sizeof(GlyphVertex))
+            {
+              textBufferBytes = vertices.capacity() * sizeof(GlyphVertex);
+              budgetDirty = true;
+            }
+          glBufferData(GL_ARRAY_BUFFER, textBufferBytes, NULL, GL_DYNAMIC_DRAW);
+        }
+      glBufferSubData(GL_ARRAY_BUFFER, from * sizeof(GlyphVertex), (vertices.size() - from) * sizeof(GlyphVertex),
+                      vertices.data() + from);
+      state->countUpload((vertices.size() - from) * sizeof(GlyphVertex));
+      batchLoaded = true;
+      streamDirty = true;
+    }
+
+  // caller places vertices itself, without origin
+  GLfloat batchMatrix[4][4];
+  orthoMatrix(metrics.getProjMatrix(), batchMatrix);
+  state->useProgram(shared->text_prog);
+  glUniformMatrix4fv(shared->text_matrix, 1, GL_FALSE, &batchMatrix[0][0]);
+  state->bindTexture(GL_TEXTURE0, atlasTexture, GL_TEXTURE_2D_ARRAY);
+  state->bindVertexArray(text_VAO);
+  glDrawArrays(GL_TRIANGLES, 0, vertices.size());
+  state->countDraw();
+}
+
+
+/*!
+ * \brief RenderText::setupLayout
+ * \param layout layout of caller, e.g. of panel
+ *    that's rendered with \fn renderBatch()
+ *
+ * Give \param layout glyph metrics of the atlas and
+ * device pixel ratio, caller should pass later ratios
+ * to \fn TextLayout::setDeviceScale() itself.
+ * Should be called after \fn initTextRender().
+ */
+void RenderText::setupLayout(TextLayout &layout)
+{
+  if(!shared)
+    return;
+
+  layout.setDeviceScale(deviceScale);
+  layout.setGlyphs(shared->Characters, shared->characterWidth, shared->characterHeight,
+                   shared->texAtlas.colFactor);
+}
+
+
+/*!
+ * \brief RenderText::cacheLayer
+ * \param layer layer to render to its texture
+ * \param index index of layer, selects its quad in \var layer_VBO
+ *
+ * Texture is of viewport size, so one texel is one pixel
+ * and glyphs stay sharp. Alpha is accumulated separately,
+ * so texture holds premultiplied colors. Text program
+ * and vertex array should be bound.
+ */
+void RenderText::cacheLayer(Layer &layer, int index)
+{
+  TRACE_ZONE("cache layer");
+  GLint viewport[4];
+  glGetIntegerv(GL_VIEWPORT, viewport);
+
+  if(layer.fbo == 0)
+    {
+      glGenFramebuffers(1, &layer.fbo);
+      glGenTextures(1, &layer.texture);
+    }
+
+  glBindFramebuffer(GL_FRAMEBUFFER, layer.fbo);
+  if((layer.texWidth != viewport[2]) || (layer.texHeight != viewport[3]))
+    {
+      layer.texWidth = viewport[2];
+      layer.texHeight = viewport[3];
+
+      state->bindTexture(GL_TEXTURE1, layer.texture);
+      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, layer.texWidth, layer.texHeight, 0,
+                   GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+      glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer.texture, 0);
+      budgetDirty = true;
+    }
+
+  glViewport(0, 0, layer.texWidth, layer.texHeight);
+  state->setScissor(false);
+  const GLfloat transparent[4] = { 0, 0, 0, 0 };
+  glClearBufferfv(GL_COLOR, 0, transparent);
+
+  glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+  glDrawArrays(GL_TRIANGLES, layer.first, layer.count);
+  state->countDraw();
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, QOpenGLContext::currentContext()->defaultFramebufferObject());
+  glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+
+  // quad over bounding box of layer, in normalized device coordinates
+  double left = 1, right = -1, bottom = 1, top = -1;
+  for(GLint v = layer.first; v < layer.first + layer.count; v++)
+    {
+      const Proj &pr = frame->proj;
+      double x = 2 * (frame->vertices[v].x + frame->originX - pr.left) / (pr.right - pr.left) - 1;
+      double y = 2 * (frame->vertices[v].y + frame->originY - pr.bottom) / (pr.top - pr.bottom) - 1;
+      left = std::min(left, x);
+      right = std::max(right, x);
+      bottom = std::min(bottom, y);
+      top = std::max(top, y);
+    }
+  left = std::max(left, -1.0);
+  right = std::min(right, 1.0);
+  bottom = std::max(bottom, -1.0);
+  top = std::min(top, 1.0);
+
+  GLfloat l = left, r = right, b = bottom, t = top;
+  GLfloat tl = (l + 1) / 2, tr = (r + 1) / 2, tb = (b + 1) / 2, tt = (t + 1) / 2;
+  GLfloat quad[6][4] = {
+    { l, t, tl, tt },
+    { l, b, tl, tb },
+    { r, b, tr, tb },
+
+    { l, t, tl, tt },
+    { r, b, tr, tb },
+    { r, t, tr, tt }
+  };
+  state->bindArrayBuffer(layer_VBO);
+  glBufferSubData(GL_ARRAY_BUFFER, index * sizeof(quad), sizeof(quad), quad);
+  state->countUpload(sizeof(quad));
+
+  layer.cached = true;
+}
+
+
+/*!
+ * \brief RenderText::invalidateLayers
+ *
+ * Render all layers again, e.g. after viewport
+ * or glyph atlas is changed.
+ */
+void RenderText::invalidateLayers()
+{
+  layers[TextLayout::horizontal].changed = true;
+  layers[TextLayout::vertical].changed = true;
 }
 
 
@@ -123,10 +707,21 @@ void RenderText::renderText()
  */
 void RenderText::setProjMatrix(Proj &pr)
 {
-  proj.left = pr.left;
-  proj.bottom = pr.bottom;
-  proj.right = pr.right;
-  proj.top = pr.top;
+  metrics.setProjMatrix(pr);
+}
+
+
+/*!
+ * \brief RenderText::setPlotArea
+ * \param area part of widget data is drawn in, e.g. view
+ *    of plot before space for text was reserved
+ *
+ * Chrome is framed around it after the next
+ * \fn updateTextPositions(). Empty area has no chrome.
+ */
+void RenderText::setPlotArea(const Proj &area)
+{
+  plotArea = area;
 }
 
 
@@ -136,431 +731,1037 @@ void RenderText::setProjMatrix(Proj &pr)
  */
 Proj RenderText::getProjMatrix()
 {
-  return proj;
+  return metrics.getProjMatrix();
 }
 
 
 /*!
  * \brief RenderText::updateShaderMatrix
+ *
+ * Program is shared with other widgets, so
+ * matrix is only kept here and loaded to
+ * shaders on every render.
  */
 void RenderText::updateShaderMatrix()
 {
+  updateOrigin();
+
   // Create projection matrix to load to shaders
-  float proj_matrix[4][4] = {
-    { 2/(proj.right - proj.left),            0,               0,        0 },
-    {              0,             2/(proj.top - proj.bottom), 0,        0 },
-    {              0,                        0,              -2/(-1-1), 0 },
-    { -(proj.right + proj.left)/(proj.right - proj.left),
-      -(proj.top + proj.bottom)/(proj.top - proj.bottom),
-      -(-1+1)/(-1-1), 1   }
-  };
-  // Update projection matrix in shaders
-  glUseProgram(text_prog);
-  glUniformMatrix4fv(glGetUniformLocation(text_prog, "ModelViewProjectionMatrix"), 1, GL_FALSE, &proj_matrix[0][0]);
+  Proj shifted = metrics.getProjMatrix();
+  shifted.left -= originX;
+  shifted.right -= originX;
+  shifted.bottom -= originY;
+  shifted.top -= originY;
+  orthoMatrix(shifted, projMatrix);
 }
 
 
 /*!
- * \brief RenderText::hintToPixel
- * \param num number to hint
- * \param pixelsize size of pixel that we need to hint \param num to.
- * \return hinted \param num
+ * \brief RenderText::updateOrigin
  *
- * We need to make sure that some varriables are put exactly
- * on edges of pixels. It should be done due to subpixel
- * interpolation of text, so the rendered textures won't
- * look fuzzy.
+ * Vertices are floats, far from zero they can't tell
+ * pixels apart, so text is placed relative to a whole
+ * pixel near the view. It's kept while view stays within
+ * TEXT_ORIGIN_SPAN views of it and pixel sizes don't
+ * change, otherwise retained labels and values of matrix
+ * are laid out again from the new one.
  */
-double RenderText::hintToPixel(double num, double pixelsize)
+void RenderText::updateOrigin()
 {
-  double md;
-  double frac = modf((num / pixelsize), &md);   // hint num to be in integer size in pixels
-  if (1.0 - frac < 0.01)                        // handle almost integer size in pixels
-    ++md;
-  if (1.0 - frac > 1.0)                         // handle if value is negative
-    --md;
-  return (md * pixelsize);
+  const Proj &proj = metrics.getProjMatrix();
+  double pixelWidth = metrics.getPixelWidth();
+  double pixelHeight = metrics.getPixelHeight();
+  if((pixelWidth <= 0) || (pixelHeight <= 0))
+    return;
+
+  bool same_scale = (fabs(pixelWidth - originPixelWidth) <= pixelWidth * 1e-6) &&
+                    (fabs(pixelHeight - originPixelHeight) <= pixelHeight * 1e-6);
+  if(same_scale &&
+     (fabs(proj.left - originX) <= TEXT_ORIGIN_SPAN * (proj.right - proj.left)) &&
+     (fabs(proj.bottom - originY) <= TEXT_ORIGIN_SPAN * (proj.top - proj.bottom)))
+    return;
+
+  originPixelWidth = pixelWidth;
+  originPixelHeight = pixelHeight;
+  originX = TextLayout::hintToPixel(proj.left, pixelWidth);
+  originY = TextLayout::hintToPixel(proj.bottom, pixelHeight);
+  labelLayout.setOrigin(originX, originY);
+  matrixLabels.setOrigin(originX, originY);
+  labelsRelayout = true;
 }
 
 
 /*!
- * \brief RenderText::reserveAxisSpace
+ * \brief RenderText::reserveSpace
  * \param width
  * \param height
  *
- * Spesific function for me. Used to print text
- * in the left and bottom part of the screen and
- * don't paint over some objects on OpenGL scene
+ * Used to print text in the left and bottom part of
+ * the screen and don't paint over some objects on
+ * OpenGL scene, see \fn TextMetrics::reserveSpace().
  */
 void RenderText::reserveSpace(int width, int height)
 {
-  // example value to test reserving enough space for text
-  int pix_x_offs = textMaxWidth + characterWidth;  // text width * number of characters + offset
-  int pix_y_offs = textHeight + 2;       // text height + offset
-
-  double del_w = pix_x_offs * pixelWidth / static_cast<double>(width);                  // how much pixel size will change after reserving space for text
-  double del_h = pix_y_offs * pixelHeight / static_cast<double>(height);
-
-  proj.left -= (pixelWidth + del_w) * pix_x_offs;                         // reserve enough space for text texture
-  proj.bottom -= (pixelHeight + del_h) * pix_y_offs;
-  proj.right += pixelWidth * 10;
-  proj.top += pixelHeight * (textHeight / 2);
-
-  pixelWidth = (proj.right - proj.left) / static_cast<double>(width);    // recalculate pixel sizes
-  pixelHeight = (proj.top - proj.bottom) / static_cast<double>(height);
-
-  proj.left = hintToPixel(proj.left, pixelWidth);                      // due to sublixel text interpolation, we need to make projection matrix
-  proj.right = hintToPixel(proj.right, pixelWidth);                    // to be equal to integer number in pixels
-  proj.bottom = hintToPixel(proj.bottom, pixelHeight);
-  proj.top = hintToPixel(proj.top, pixelHeight);
+  metrics.reserveSpace(width, height);
 }
 
 
 /*!
- * \brief Plot::createShader
+ * \brief RenderText::createShader
  * \param vertexShader
  * \param fragmentShader
  * \return compiled shader program
  *
- * Compile passed OpenGL shaders to OpenGL program.
- * Use compiled program to update uniforms and load needed
- * vertex array objects (if OpenGl version supports it) with
- * value to pass to shaders. To do so, you need to use
- * \fn glUseProgram(...) with returned variable and \fn glBindVertexArray()
- * to change buffer without the need to change values, or \fn glUniform()
- * with the name of uniform to update it's values
+ * Compile passed OpenGL shaders to OpenGL program,
+ * see \fn createShaderProgram()
  */
 int RenderText::createShader(const char* vertexShader, const char* fragmentShader)
 {
-  GLint state = 0;
-  GLint loglen = 0;
+  return createShaderProgram(this, vertexShader, fragmentShader);
+}
+
+
+/*!
+ * \brief RenderText::measureText
+ * \param num value to measure
+ * \return width of printed \param num in pixels
+ *
+ * Slice value the same way \fn setText() does,
+ * but don't store it anywhere. Needs no context.
+ */
+int RenderText::measureText(double num)
+{
+  return metrics.measureText(num);
+}
+
 
-  GLuint vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vertexShader, NULL);
-  glCompileShader(vertex);
-  glGetShaderiv(vertex, GL_COMPILE_STATUS, &state);
-  if(state == GL_FALSE)
+/*!
+ * \brief RenderText::setText
+ * \param y values to print on the left axis
+ * \param x values to print on the bottom axis
+ *
+ * Only width of the widest label is measured here, so
+ * space for text can be reserved. Labels are sliced into
+ * characters and laid out on worker thread after the next
+ * \fn updateTextPositions() call.
+ * Values are expected to be sorted ascending.
+ */
+void RenderText::setText(const std::vector<double> &y, const std::vector<double> &x)
+{
+  metrics.measureLabels(y);
+  labelsY = y;
+  labelsX = x;
+}
+
+
+/*!
+ * \brief RenderText::updateTextPositions
+ *
+ * Request labels to be laid out for current projection
+ * matrix and pixel sizes. Call after resize events and
+ * \fn setText() calls. Layout, glyph lookup and vertex
+ * packing run on worker thread, see \class FrameBuilder,
+ * so this never waits. Frame appears in one of the
+ * next \fn renderText() calls, widget is asked to
+ * repaint when it's ready.
+ * Retained labels are laid out again only if pixel
+ * sizes changed, shifted view only changes matrix.
+ */
+void RenderText::updateTextPositions()
+{
+  updateOrigin();
+  const Proj &proj = metrics.getProjMatrix();
+  double pixelWidth = metrics.getPixelWidth();
+  double pixelHeight = metrics.getPixelHeight();
+  if((fabs(pixelWidth - labelPixelWidth) > pixelWidth * 1e-6) ||
+     (fabs(pixelHeight - labelPixelHeight) > pixelHeight * 1e-6))
     {
-      glGetShaderiv(vertex, GL_INFO_LOG_LENGTH, &loglen);
-      GLchar *infolog = new GLchar[loglen];
-      glGetShaderInfoLog(vertex, loglen, NULL, infolog);
-      printf("vertex shader failed, %s\n", infolog);
-      delete[] infolog;
+      labelPixelWidth = pixelWidth;
+      labelPixelHeight = pixelHeight;
+      labelsRelayout = true;
     }
+  labelLayout.setView(proj, pixelWidth, pixelHeight);
+
+  if(!builder)
+    return;
 
-  GLuint fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fragmentShader, NULL);
-  glCompileShader(fragment);
-  glGetShaderiv(fragment, GL_COMPILE_STATUS, &state);
-  if(state == GL_FALSE)
+  LayoutRequest &req = builder->request();
+  req.y = labelsY;
+  req.x = labelsX;
+  req.yStyles.clear();
+  req.xStyles.clear();
+  if(!labelStyles[TextLayout::vertical].empty())
     {
-      glGetShaderiv(fragment, GL_INFO_LOG_LENGTH, &loglen);
-      GLchar *infolog = new GLchar[loglen];
-      glGetShaderInfoLog(fragment, loglen, NULL, infolog);
-      printf("fragment shader failed, %s\n", infolog);
-      delete[] infolog;
+      for(uint i = 0; i < labelsY.size(); i++)
+        {
+          std::unordered_map<double, TextStyle>::iterator it = labelStyles[TextLayout::vertical].find(labelsY[i]);
+          req.yStyles.push_back((it != labelStyles[TextLayout::vertical].end()) ? it->second : defaultTextStyle);
+        }
     }
-
-  GLuint program = glCreateProgram();
-  glAttachShader(program, vertex);
-  glAttachShader(program, fragment);
-  glLinkProgram(program);
-  glGetProgramiv(program, GL_LINK_STATUS, &state);
-  if(state == GL_FALSE)
+  if(!labelStyles[TextLayout::horizontal].empty())
     {
-      glGetProgramiv(program, GL_INFO_LOG_LENGTH, &loglen);
-      GLchar *infolog = new GLchar[loglen];
-      glGetProgramInfoLog(program, loglen, NULL, infolog);
-      printf("program shader link failed, %s\n", infolog);
-      delete[] infolog;
+      for(uint i = 0; i < labelsX.size(); i++)
+        {
+          std::unordered_map<double, TextStyle>::iterator it = labelStyles[TextLayout::horizontal].find(labelsX[i]);
+          req.xStyles.push_back((it != labelStyles[TextLayout::horizontal].end()) ? it->second : defaultTextStyle);
+        }
     }
+  req.proj = proj;
+  req.area = plotArea;
+  req.pixelWidth = pixelWidth;
+  req.pixelHeight = pixelHeight;
+  req.originX = originX;
+  req.originY = originY;
+  req.deviceScale = deviceScale;
+  req.compact = compactLayout;
+  compactLayout = false;
+  builder->submit();
+}
 
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
 
-  return program;
+/*!
+ * \brief RenderText::waitLayout
+ *
+ * Block until labels of the last \fn updateTextPositions()
+ * are laid out, see \fn FrameBuilder::wait(). Renders
+ * never call it.
+ */
+void RenderText::waitLayout()
+{
+  if(builder)
+    builder->wait();
 }
 
 
 /*!
- * \brief RenderText::getCharFromFloat
- * \param number vector where char numbers will be stored
- * \param input float value to divide by char numbers
+ * \brief RenderText::setLabelStyle
+ * \param value label to style, when it's printed
+ * \param ar axis of label
+ * \param style color, opacity and emphasis of label
  *
- * Simple function to slice float number into char characters
+ * Styles are kept until \fn clearLabelStyles(), so they
+ * stay with values when axis scrolls. Labels are laid
+ * out again after the next \fn updateTextPositions().
  */
-void RenderText::getCharFromFloat(std::vector<char> *number, double input)
+void RenderText::setLabelStyle(double value, TextLayout::Arrange ar, const TextStyle &style)
 {
-  double frac_part = 0;
-  double int_part = 0;
-  int offs_begin = 0;
-  int offs_end = 0;
+  if(style == defaultTextStyle)
+    labelStyles[ar].erase(value);
+  else
+    labelStyles[ar][value] = style;
+}
 
-  number->reserve(MAX_CH);
 
-  frac_part = modf((input), &int_part);
+/*!
+ * \brief RenderText::clearLabelStyles
+ *
+ * Print all labels with \var defaultTextStyle.
+ */
+void RenderText::clearLabelStyles()
+{
+  labelStyles[TextLayout::horizontal].clear();
+  labelStyles[TextLayout::vertical].clear();
+}
+
 
-  if(int_part < 0)
+/*!
+ * \brief RenderText::addLabel
+ * \param text characters to print, up to LABEL_SLOT_GLYPHS of them
+ * \param x left edge of text in values of projection matrix,
+ *    anchor of it with \param anchor
+ * \param y bottom edge of text
+ * \param style color, opacity and emphasis of text
+ * \param anchor rotation and alignment of text around \param x, \param y
+ * \return id of label, INVALID_LABEL if there are no free slots
+ *
+ * Label is kept until \fn removeLabel() and drawn over
+ * labels of axes. It takes one fixed size slot of label
+ * vertex buffer, released slots are reused, so adding,
+ * changing and removing label costs O(1) and only its
+ * slot is loaded again before the next render.
+ */
+LabelId RenderText::addLabel(const std::string &text, double x, double y, const TextStyle &style,
+                             const TextAnchor &anchor)
+{
+  size_t slot = labelSlots.allocate();
+  if(slot >= (1u << LABEL_SLOT_BITS))
     {
-      number->push_back('-');
-      offs_begin = 1;
-      int_part *= -1;
-      frac_part *= -1;
+      labelSlots.release(slot);
+      return INVALID_LABEL;
     }
 
-  if(int_part == 0)
+  if(slot >= labels.size())
     {
-      number->push_back('0');
+      Label label = { std::string(), 0, 0, defaultTextStyle, defaultAnchor, 0, false, false };
+      labels.resize(slot + 1, label);
     }
 
+  Label &label = labels[slot];
+  labelTextBytes += text.size() - label.text.size();
+  label.text = text;
+  label.x = x;
+  label.y = y;
+  label.style = style;
+  label.anchor = anchor;
+  label.alive = true;
+  touchLabel(slot);
+  budgetDirty = true;
+
+  return (static_cast<LabelId>(label.generation) << LABEL_SLOT_BITS) | static_cast<LabelId>(slot);
+}
+
+
+/*!
+ * \brief RenderText::addLabel
+ * \param value printed the same way labels of axes are
+ * \param x left edge of text in values of projection matrix
+ * \param y bottom edge of text
+ * \param style color, opacity and emphasis of text
+ * \param anchor rotation and alignment of text
+ * \return id of label, INVALID_LABEL if there are no free slots
+ */
+LabelId RenderText::addLabel(double value, double x, double y, const TextStyle &style, const TextAnchor &anchor)
+{
+  std::vector<char> print;
+  TextLayout::getCharFromFloat(&print, value);
+  return addLabel(std::string(print.begin(), print.end()), x, y, style, anchor);
+}
+
+
+/*!
+ * \brief RenderText::updateLabel
+ * \param id label from \fn addLabel()
+ * \param text new characters to print
+ * \param x new left edge of text
+ * \param y new bottom edge of text
+ * \param style new style of text
+ * \param anchor new rotation and alignment of text
+ * \return false if label was already removed
+ */
+bool RenderText::updateLabel(LabelId id, const std::string &text, double x, double y, const TextStyle &style,
+                             const TextAnchor &anchor)
+{
+  Label *label = findLabel(id);
+  if(label == nullptr)
+    return false;
+
+  labelTextBytes += text.size() - label->text.size();
+  label->text = text;
+  label->x = x;
+  label->y = y;
+  label->style = style;
+  label->anchor = anchor;
+  touchLabel(id & ((1u << LABEL_SLOT_BITS) - 1));
+  budgetDirty = true;
+  return true;
+}
+
+
+/*!
+ * \brief RenderText::moveLabel
+ * \param id label from \fn addLabel()
+ * \param x new left edge of text
+ * \param y new bottom edge of text
+ * \return false if label was already removed
+ */
+bool RenderText::moveLabel(LabelId id, double x, double y)
+{
+  Label *label = findLabel(id);
+  if(label == nullptr)
+    return false;
+
+  label->x = x;
+  label->y = y;
+  touchLabel(id & ((1u << LABEL_SLOT_BITS) - 1));
+  return true;
+}
 
-  double add_int_part = 0;
-  char to_vector;
-  while (int_part > 0)
+
+/*!
+ * \brief RenderText::removeLabel
+ * \param id label from \fn addLabel()
+ * \return false if label was already removed
+ *
+ * Slot is cleared and reused by the next
+ * \fn addLabel(), \param id is not valid anymore.
+ */
+bool RenderText::removeLabel(LabelId id)
+{
+  Label *label = findLabel(id);
+  if(label == nullptr)
+    return false;
+
+  size_t slot = id & ((1u << LABEL_SLOT_BITS) - 1);
+  label->alive = false;
+  labelTextBytes -= label->text.size();
+  label->text.clear();
+  label->generation = (label->generation + 1) & ((1u << (32 - LABEL_SLOT_BITS)) - 1);
+  labelSlots.release(slot);
+  touchLabel(slot);
+  budgetDirty = true;
+  return true;
+}
+
+
+/*!
+ * \brief RenderText::measureString
+ * \param text characters to measure
+ * \param style emphasis of text
+ * \return width of printed \param text in pixels, e.g. to align labels
+ */
+int RenderText::measureString(const std::string &text, const TextStyle &style)
+{
+  if(!shared)
+    return 0;
+  return labelLayout.measureString(text, style);
+}
+
+
+/*!
+ * \brief RenderText::findLabel
+ * \param id label from \fn addLabel()
+ * \return label, null if \param id is stale or invalid
+ */
+RenderText::Label *RenderText::findLabel(LabelId id)
+{
+  size_t slot = id & ((1u << LABEL_SLOT_BITS) - 1);
+  unsigned generation = id >> LABEL_SLOT_BITS;
+  if((id == INVALID_LABEL) || (slot >= labels.size()))
+    return nullptr;
+
+  Label &label = labels[slot];
+  if(!label.alive || (label.generation != generation))
+    return nullptr;
+  return &label;
+}
+
+
+/*!
+ * \brief RenderText::touchLabel
+ * \param slot slot to lay out and load before the next render
+ *
+ * Slot is queued once, however many times it changes
+ * between renders.
+ */
+void RenderText::touchLabel(size_t slot)
+{
+  if(labels[slot].dirty)
+    return;
+  labels[slot].dirty = true;
+  dirtyLabels.push_back(slot);
+}
+
+
+/*!
+ * \brief RenderText::layoutLabel
+ * \param slot slot to fill in \var labelVertices
+ *
+ * Vertices of unused glyphs are zeroed, so
+ * their triangles are degenerate and not drawn.
+ */
+void RenderText::layoutLabel(size_t slot)
+{
+  GlyphVertex empty = {};
+  if(labelVertices.size() < (slot + 1) * LABEL_SLOT_VERTICES)
     {
-      add_int_part = modf((int_part / 10), &int_part);
-      add_int_part *= 10;
-      to_vector = static_cast<char>(char('0') + (add_int_part + 0.00001));
-      number->push_back(to_vector);
+      labelVertices.resize((slot + 1) * LABEL_SLOT_VERTICES, empty);
+      budgetDirty = true;
     }
 
-  if(frac_part > 0)
+  const Label &label = labels[slot];
+  GlyphVertex *out = &labelVertices[slot * LABEL_SLOT_VERTICES];
+  size_t glyphs = 0;
+  if(label.alive)
+    glyphs = labelLayout.placeString(label.text, label.x, label.y, label.style, label.anchor, out, LABEL_SLOT_GLYPHS);
+
+  std::fill(out + glyphs * 6, out + LABEL_SLOT_VERTICES, empty);
+}
+
+
+/*!
+ * \brief RenderText::uploadLabels
+ * \param from first slot to load to \var label_VBO
+ * \param to slot after the last one
+ */
+void RenderText::uploadLabels(size_t from, size_t to)
+{
+  TRACE_ZONE("upload labels");
+  state->bindArrayBuffer(label_VBO);
+  glBufferSubData(GL_ARRAY_BUFFER, from * LABEL_SLOT_VERTICES * sizeof(GlyphVertex),
+                  (to - from) * LABEL_SLOT_VERTICES * sizeof(GlyphVertex),
+                  &labelVertices[from * LABEL_SLOT_VERTICES]);
+  state->countUpload((to - from) * LABEL_SLOT_VERTICES * sizeof(GlyphVertex));
+}
+
+
+/*!
+ * \brief RenderText::renderLabels
+ *
+ * Lay out slots changed since the last render and
+ * load them, neighbouring slots with one call. Buffer
+ * grows twice when slots don't fit, then all of them
+ * are loaded. All retained labels are drawn with
+ * one call, in values of current projection matrix.
+ */
+void RenderText::renderLabels()
+{
+  TRACE_ZONE("draw labels");
+  if(!shared)
+    return;
+  selectAtlas();
+  checkBudget();
+  size_t slotCount = labelSlots.highWater();
+  if(slotCount == 0)
+    return;
+
+  if(labelsRelayout)
     {
-      number->push_back(',');
-      ++offs_end;
+      for(size_t i = 0; i < slotCount; i++)
+        layoutLabel(i);
     }
   else
     {
-      std::reverse((number->begin() + offs_begin), number->end());
-      return;
+      for(size_t i = 0; i < dirtyLabels.size(); i++)
+        layoutLabel(dirtyLabels[i]);
     }
 
-  frac_part += 0.00000001;
-  double add_frac_part = 0;
-  double a = 0.0000001;
-  while ( frac_part > 0)
+  if(labelsRelayout || (slotCount > labelBufferSlots))
     {
-      frac_part = modf((frac_part * 10), &add_frac_part);
-      to_vector = static_cast<char>(char('0')  + (add_frac_part));
-      number->push_back(to_vector);
-      ++offs_end;
-      a *= 10;
-      if((frac_part < a) || (offs_end > MAX_CH - 2))
+      if(slotCount > labelBufferSlots)
         {
-          break;
+          labelBufferSlots = std::max(std::max(slotCount, labelBufferSlots * 2), static_cast<size_t>(LABEL_MIN_SLOTS));
+          state->bindArrayBuffer(label_VBO);
+          glBufferData(GL_ARRAY_BUFFER, labelBufferSlots * LABEL_SLOT_VERTICES * sizeof(GlyphVertex),
+                       NULL, GL_DYNAMIC_DRAW);
+          budgetDirty = true;
         }
+      uploadLabels(0, slotCount);
+    }
+  else if(!dirtyLabels.empty())
+    {
+      std::sort(dirtyLabels.begin(), dirtyLabels.end());
+      size_t from = dirtyLabels[0];
+      size_t to = from + 1;
+      for(size_t i = 1; i < dirtyLabels.size(); i++)
+        {
+          if(dirtyLabels[i] != to)
+            {
+              uploadLabels(from, to);
+              from = dirtyLabels[i];
+            }
+          to = dirtyLabels[i] + 1;
+        }
+      uploadLabels(from, to);
     }
 
-  std::reverse((number->begin() + offs_begin), (number->end() - offs_end));
+  for(size_t i = 0; i < dirtyLabels.size(); i++)
+    labels[dirtyLabels[i]].dirty = false;
+  dirtyLabels.clear();
+  labelsRelayout = false;
+
+  if(labelSlots.used() == 0)
+    return;
+
+  state->useProgram(shared->text_prog);
+  glUniformMatrix4fv(shared->text_matrix, 1, GL_FALSE, &projMatrix[0][0]);
+  // device pixel offsets of rotated labels, other text has none
+  glUniform2f(shared->text_pixel, projMatrix[0][0] * metrics.getPixelWidth() / deviceScale,
+              projMatrix[1][1] * metrics.getPixelHeight() / deviceScale);
+  state->bindTexture(GL_TEXTURE0, atlasTexture, GL_TEXTURE_2D_ARRAY);
+  state->bindVertexArray(label_VAO);
+  glDrawArrays(GL_TRIANGLES, 0, slotCount * LABEL_SLOT_VERTICES);
+  state->countDraw();
 }
 
 
 /*!
- * \brief RenderText::setText
- * \param y
- * \param x
+ * \brief RenderText::setMatrix
+ * \param values row after row, kept by caller while matrix
+ *    is shown, null to remove matrix
+ * \param rows rows of matrix
+ * \param columns columns of matrix
+ * \param stride values from one row to the next one
+ * \param area values of projection matrix matrix covers,
+ *    row 0 at the top
  *
+ * Print value of every cell in its center, e.g. of heatmap.
+ * Only cells fully inside plot area are formatted and laid
+ * out, see \class MatrixLabels, so size of matrix doesn't
+ * matter. Values are read at render, after they change
+ * call \fn updateMatrixCell() or \fn updateMatrix().
+ */
+void RenderText::setMatrix(const double *values, size_t rows, size_t columns, size_t stride, const Proj &area)
+{
+  matrixLabels.setMatrix(values, rows, columns, stride, area);
+}
+
+
+/*!
+ * \brief RenderText::updateMatrixCell
+ * \param row cell which value changed
+ * \param column
  *
+ * Only slot of cell is laid out and loaded again,
+ * if it's visible. Many changes between renders
+ * are merged.
  */
-void RenderText::setText(std::vector<double> &y, std::vector<double> &x)
+void RenderText::updateMatrixCell(size_t row, size_t column)
 {
-  textBoxes.clear();
-  textBoxes.resize(y.size() + x.size());
+  matrixLabels.touchCell(row, column);
+}
 
-  textMaxWidth = 0;
-  textHeight = characterHeight;
-  int max = 0;
 
-  for(uint i = 0; i < y.size(); i++)
-    {
-      textBoxes[i].num = y[i];
-      getCharFromFloat(&textBoxes[i].print, y[i]);
-      textBoxes[i].printInfo.resize(textBoxes[i].print.size());
-      textBoxes[i].ar = Arrange::vertical;
-      textBoxes[i].pos.resize(textBoxes[i].print.size() * 6 * 4);
-      textBoxes[i].width = textBoxes[i].print.size() * characterWidth;
+/*!
+ * \brief RenderText::updateMatrix
+ *
+ * All values of matrix changed, visible
+ * cells are laid out again.
+ */
+void RenderText::updateMatrix()
+{
+  matrixLabels.touchAll();
+}
 
-      max = textBoxes[i].width;
-      if(max > textMaxWidth)
-        {
-          textMaxWidth = max;
-        }
 
-      for(uint j = 0; j < textBoxes[i].print.size(); j++)
+/*!
+ * \brief RenderText::uploadMatrix
+ * \param from first slot to load to \var matrix_VBO
+ * \param to slot after the last one
+ */
+void RenderText::uploadMatrix(size_t from, size_t to)
+{
+  TRACE_ZONE("upload matrix");
+  state->bindArrayBuffer(matrix_VBO);
+  glBufferSubData(GL_ARRAY_BUFFER, from * MATRIX_CELL_VERTICES * sizeof(GlyphVertex),
+                  (to - from) * MATRIX_CELL_VERTICES * sizeof(GlyphVertex),
+                  matrixLabels.slotVertices(from));
+  state->countUpload((to - from) * MATRIX_CELL_VERTICES * sizeof(GlyphVertex));
+}
+
+
+/*!
+ * \brief RenderText::renderMatrix
+ *
+ * Lay out cells that came into view or changed and
+ * load their slots, neighbouring slots with one call.
+ * All visible cells are drawn with one call, in values
+ * of current projection matrix. Nothing is drawn when
+ * cells are too small for labels.
+ */
+void RenderText::renderMatrix()
+{
+  TRACE_ZONE("draw matrix");
+  if(!shared)
+    return;
+  checkBudget();
+
+  matrixLabels.setView(plotArea, metrics.getPixelWidth(), metrics.getPixelHeight());
+  size_t slotCount = matrixLabels.update();
+  if(slotCount == 0)
+    return;
+  selectAtlas();
+
+  const std::vector<size_t> &changed = matrixLabels.changedSlots();
+  if(slotCount > matrixBufferSlots)
+    {
+      matrixBufferSlots = slotCount;
+      state->bindArrayBuffer(matrix_VBO);
+      glBufferData(GL_ARRAY_BUFFER, matrixBufferSlots * MATRIX_CELL_VERTICES * sizeof(GlyphVertex),
+                   NULL, GL_DYNAMIC_DRAW);
+      uploadMatrix(0, slotCount);
+      budgetDirty = true;
+    }
+  else if(matrixLabels.allChanged())
+    {
+      // ring of slots may have been resized
+      uploadMatrix(0, slotCount);
+      budgetDirty = true;
+    }
+  else if(!changed.empty())
+    {
+      size_t from = changed[0];
+      size_t to = from + 1;
+      for(size_t i = 1; i < changed.size(); i++)
         {
-          textBoxes[i].printInfo[j].Advance = Characters.at(textBoxes[i].print[j]).Advance;
-          textBoxes[i].printInfo[j].Bearing = Characters.at(textBoxes[i].print[j]).BearingX;
-          textBoxes[i].printInfo[j].texX = Characters.at(textBoxes[i].print[j]).texX;
+          if(changed[i] != to)
+            {
+              uploadMatrix(from, to);
+              from = changed[i];
+            }
+          to = changed[i] + 1;
         }
+      uploadMatrix(from, to);
     }
 
-  for(uint i = y.size(); i < y.size() + x.size(); i++)
+  state->useProgram(shared->text_prog);
+  glUniformMatrix4fv(shared->text_matrix, 1, GL_FALSE, &projMatrix[0][0]);
+  state->bindTexture(GL_TEXTURE0, atlasTexture, GL_TEXTURE_2D_ARRAY);
+  state->bindVertexArray(matrix_VAO);
+  glDrawArrays(GL_TRIANGLES, 0, slotCount * MATRIX_CELL_VERTICES);
+  state->countDraw();
+}
+
+
+/*!
+ * \brief RenderText::memoryUsage
+ * \return bytes held by this renderer on CPU and GPU
+ *
+ * Capacities of containers and sizes of buffers and
+ * textures, without allocator and driver overhead.
+ * Frames of worker thread are as of the newest one.
+ * Atlases are shared by renderers of share group.
+ */
+TextMemory RenderText::memoryUsage()
+{
+  TextMemory usage;
+  usage.labelBytes = labels.capacity() * sizeof(Label) + labelTextBytes +
+                     labelVertices.capacity() * sizeof(GlyphVertex) +
+                     dirtyLabels.capacity() * sizeof(size_t) + labelSlots.memoryBytes();
+  usage.layoutBytes = labelLayout.memoryBytes() + ((frame != nullptr) ? frame->layoutBytes : 0);
+  usage.matrixBytes = matrixLabels.memoryBytes();
+  usage.bufferBytes = textBufferBytes + ((layer_VBO != 0) ? LAYER_BUFFER_BYTES : 0) +
+                      (labelBufferSlots * LABEL_SLOT_VERTICES + matrixBufferSlots * MATRIX_CELL_VERTICES) *
+                      sizeof(GlyphVertex);
+  usage.layerBytes = 0;
+  for(int i = 0; i < 2; i++)
     {
-      textBoxes[i].num = x[i - y.size()];
-      getCharFromFloat(&textBoxes[i].print, x[i - y.size()]);
+      if(layers[i].texture != 0)
+        usage.layerBytes += static_cast<size_t>(layers[i].texWidth) * layers[i].texHeight * 4;
+    }
+  usage.atlasBytes = shared ? shared->atlasBytes() : 0;
+  usage.cpuBytes = usage.labelBytes + usage.layoutBytes + usage.matrixBytes;
+  usage.gpuBytes = usage.bufferBytes + usage.layerBytes + usage.atlasBytes;
+  return usage;
+}
+
 
-      textBoxes[i].printInfo.resize(textBoxes[i].print.size());
-      textBoxes[i].ar = Arrange::horizontal;
-      textBoxes[i].pos.resize(textBoxes[i].print.size() * 6 * 4);
+/*!
+ * \brief RenderText::totalMemoryUsage
+ * \return bytes held by all renderers of the process,
+ *    as of their last render, atlases of every share
+ *    group counted once
+ */
+TextMemory RenderText::totalMemoryUsage()
+{
+  TextMemory total = allRenderers;
+  total.atlasBytes = TextResources::allAtlasBytes();
+  total.gpuBytes += total.atlasBytes;
+  return total;
+}
 
-      textBoxes[i].width = textBoxes[i].print.size() * characterWidth;
 
-      for(uint j = 0; j < textBoxes[i].print.size(); j++)
-        {
-          textBoxes[i].printInfo[j].Advance = Characters.at(textBoxes[i].print[j]).Advance;
-          textBoxes[i].printInfo[j].Bearing = Characters.at(textBoxes[i].print[j]).BearingX;
-          textBoxes[i].printInfo[j].texX = Characters.at(textBoxes[i].print[j]).texX;
-        }
-    }
+/*!
+ * \brief RenderText::setMemoryBudget
+ * \param cpuBytes CPU bytes of renderer, 0 is unlimited
+ * \param gpuBytes GPU bytes of renderer without atlases,
+ *    0 is unlimited
+ *
+ * Checked at renders after memory grew. Over CPU budget,
+ * labels, layouts and matrix slots release capacity they
+ * don't use. Over GPU budget, cached label layers are
+ * evicted and drawn from glyph quads until the budget is
+ * set again, and vertex buffers shrink to what's drawn.
+ * What's still in use is never released, so usage can
+ * stay over budget.
+ */
+void RenderText::setMemoryBudget(size_t cpuBytes, size_t gpuBytes)
+{
+  cpuBudget = cpuBytes;
+  gpuBudget = gpuBytes;
+  cpuCompacted = 0;
+  gpuCompacted = 0;
+  layerCaching = true;
+  budgetDirty = true;
 }
 
 
 /*!
- * \brief RenderText::updateTextPositions
+ * \brief RenderText::setAtlasBudget
+ * \param bytes bytes of atlases of each share group, 0 is unlimited
  *
- * Update positions of text of screen.
+ * Over budget, atlases no widget draws with, e.g. of
+ * screens widgets left, are evicted at the next render
+ * that takes an atlas. They're rasterized again when
+ * needed. Applies to all renderers.
+ */
+void RenderText::setAtlasBudget(size_t bytes)
+{
+  TextResources::setAtlasBudget(bytes);
+}
+
+
+/*!
+ * \brief RenderText::account
+ * \return current usage, see \fn memoryUsage()
  *
- * Call after resize events and \fn setText() calls.
- * Remember, we use triangles to render textures from texture atlas.
- * Buffer is packed [Screen X | Screen Y | Tex X | Tex Y] x6
- * Screen coords:
- * 0---*    3---5
- * | \ |    | \ |
- * 1---2    *---4
- * Texture coords:
- * 1---2    *---4
- * | / |    | / |
- * 0---*    3---5
+ * Replace usage of renderer in \fn totalMemoryUsage().
  */
-void RenderText::updateTextPositions()
+TextMemory RenderText::account()
 {
-  double xpos = 0;
-  double ypos = 0;
-  double x_hinted = 0;
-  double xpos_hinted = 0;
-  double ypos_hinted = 0;
-  double tex_pos_x = 0;
-  double char_width = characterWidth * pixelWidth;
-  double char_height = characterHeight * pixelHeight;
+  TextMemory usage = memoryUsage();
+  TextMemory counted = usage;
+  counted.gpuBytes -= counted.atlasBytes;
+  counted.atlasBytes = 0;
+  moveUsage(allRenderers, reported, counted);
+  reported = counted;
+  return usage;
+}
 
-  for(uint i = 0; i < textBoxes.size(); i++ )
+
+/*!
+ * \brief RenderText::checkBudget
+ *
+ * Account memory if it changed since the last check and
+ * compact it when it's over budget. Once compacted, it's
+ * compacted again only after it grows by 1/TEXT_BUDGET_GROWTH,
+ * so usage that can't get under budget isn't compacted
+ * at every render. Context should be current.
+ */
+void RenderText::checkBudget()
+{
+  if(!budgetDirty)
+    return;
+  budgetDirty = false;
+
+  TextMemory usage = account();
+  bool compacted = false;
+  if((cpuBudget > 0) && (usage.cpuBytes > cpuBudget) &&
+     (usage.cpuBytes > cpuCompacted + cpuCompacted / TEXT_BUDGET_GROWTH))
     {
-      if(textBoxes[i].ar == horizontal)
-        {
-          xpos = textBoxes[i].num - (textBoxes[i].width * pixelWidth / 2);
-          ypos = proj.bottom + (pixelHeight * 1);
-        }
-      if(textBoxes[i].ar == vertical)
-        {
-          xpos = proj.left + (pixelWidth * 4);
-          ypos = textBoxes[i].num - (char_height / 2);
-        }
+      compactCpu();
+      compacted = true;
+    }
+  if((gpuBudget > 0) && (usage.gpuBytes - usage.atlasBytes > gpuBudget) &&
+     (usage.gpuBytes - usage.atlasBytes > gpuCompacted + gpuCompacted / TEXT_BUDGET_GROWTH))
+    {
+      compactGpu();
+      compacted = true;
+    }
+  if((TextResources::getAtlasBudget() > 0) && (usage.atlasBytes > TextResources::getAtlasBudget()))
+    {
+      trimAtlases();
+      compacted = true;
+    }
 
-      x_hinted = hintToPixel(xpos, pixelWidth);
-      ypos_hinted = hintToPixel(ypos, pixelHeight);
-      for (uint j = 0; j < textBoxes[i].pos.size(); j+=24)
-        {
-          xpos_hinted = x_hinted + ( textBoxes[i].printInfo[j/24].Bearing * pixelWidth );
-          tex_pos_x = textBoxes[i].printInfo[j/24].texX;
+  if(compacted)
+    {
+      usage = account();
+      cpuCompacted = usage.cpuBytes;
+      gpuCompacted = usage.gpuBytes - usage.atlasBytes;
+    }
+}
 
 
-          textBoxes[i].pos[j] = xpos_hinted;
-          textBoxes[i].pos[j + 1] = ypos_hinted + char_height;
-          textBoxes[i].pos[j + 2] = tex_pos_x;
-          textBoxes[i].pos[j + 3] = 0;
+/*!
+ * \brief RenderText::compactCpu
+ *
+ * Release text of removed labels, slots above the
+ * highest retained label and capacity of layouts.
+ * Layout of worker thread is compacted with the next
+ * request, see \fn updateTextPositions().
+ */
+void RenderText::compactCpu()
+{
+  TRACE_ZONE("compact text");
+  labelSlots.trim();
+  size_t slotCount = labelSlots.highWater();
 
-          textBoxes[i].pos[j + 4] = xpos_hinted;
-          textBoxes[i].pos[j + 5] = ypos_hinted;
-          textBoxes[i].pos[j + 6] = tex_pos_x;
-          textBoxes[i].pos[j + 7] = 1.0;
+  // removed labels keep generation, so their stale ids are still refused
+  for(size_t i = 0; i < labels.size(); i++)
+    {
+      if(!labels[i].alive)
+        std::string().swap(labels[i].text);
+    }
+  std::vector<Label>(labels).swap(labels);
 
-          textBoxes[i].pos[j + 8] = xpos_hinted + char_width;
-          textBoxes[i].pos[j + 9] = ypos_hinted;
-          textBoxes[i].pos[j + 10] = tex_pos_x + texAtlas.colFactor;
-          textBoxes[i].pos[j + 11] = 1.0;
+  size_t kept = 0;
+  for(size_t i = 0; i < dirtyLabels.size(); i++)
+    {
+      if(dirtyLabels[i] < slotCount)
+        dirtyLabels[kept++] = dirtyLabels[i];
+      else
+        labels[dirtyLabels[i]].dirty = false;
+    }
+  dirtyLabels.resize(kept);
+  std::vector<size_t>(dirtyLabels).swap(dirtyLabels);
 
-          textBoxes[i].pos[j + 12] = xpos_hinted;
-          textBoxes[i].pos[j + 13] = ypos_hinted + char_height;
-          textBoxes[i].pos[j + 14] = tex_pos_x;
-          textBoxes[i].pos[j + 15] = 0;
+  labelVertices.resize(std::min(labelVertices.size(), slotCount * LABEL_SLOT_VERTICES));
+  std::vector<GlyphVertex>(labelVertices).swap(labelVertices);
 
-          textBoxes[i].pos[j + 16] = xpos_hinted + char_width;
-          textBoxes[i].pos[j + 17] = ypos_hinted;
-          textBoxes[i].pos[j + 18] = tex_pos_x + texAtlas.colFactor;
-          textBoxes[i].pos[j + 19] = 1.0;
+  labelLayout.compact();
+  matrixLabels.compact();
+  compactLayout = true;
+}
 
-          textBoxes[i].pos[j + 20] = xpos_hinted + char_width;
-          textBoxes[i].pos[j + 21] = ypos_hinted + char_height;
-          textBoxes[i].pos[j + 22] = tex_pos_x + texAtlas.colFactor;
-          textBoxes[i].pos[j + 23] = 0;
 
-          x_hinted += textBoxes[i].printInfo[j/24].Advance * pixelWidth;
+/*!
+ * \brief RenderText::compactGpu
+ *
+ * Evict cached label layers and stop caching them,
+ * shrink vertex buffers to the slots drawn now.
+ * Shrunk buffers are loaded again at the next render.
+ */
+void RenderText::compactGpu()
+{
+  TRACE_ZONE("compact text buffers");
+  for(int i = 0; i < 2; i++)
+    {
+      if(layers[i].fbo != 0)
+        {
+          glDeleteFramebuffers(1, &layers[i].fbo);
+          glDeleteTextures(1, &layers[i].texture);
+          layers[i].fbo = 0;
+          layers[i].texture = 0;
+          layers[i].texWidth = 0;
+          layers[i].texHeight = 0;
         }
+      layers[i].cached = false;
+    }
+  layerCaching = false;
+
+  size_t slotCount = labelSlots.highWater();
+  if(labelBufferSlots > slotCount)
+    {
+      labelBufferSlots = slotCount;
+      state->bindArrayBuffer(label_VBO);
+      glBufferData(GL_ARRAY_BUFFER, labelBufferSlots * LABEL_SLOT_VERTICES * sizeof(GlyphVertex),
+                   NULL, GL_DYNAMIC_DRAW);
+      labelsRelayout = true;
     }
+
+  // reallocated to the visible cells at the next render
+  if(matrixBufferSlots > 0)
+    {
+      matrixBufferSlots = 0;
+      state->bindArrayBuffer(matrix_VBO);
+      glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_DYNAMIC_DRAW);
+    }
+  state->invalidate();
+}
+
+
+/*!
+ * \brief RenderText::trimAtlases
+ *
+ * Evict atlases no renderer draws with, until atlases
+ * of share group fit to budget or only used ones are
+ * left. Atlases renderers fall back to while their own
+ * ones are rasterized are used too.
+ */
+void RenderText::trimAtlases()
+{
+  std::unordered_map<int, AtlasTexture>::iterator it = shared->atlases.begin();
+  while((it != shared->atlases.end()) && (shared->atlasBytes() > TextResources::getAtlasBudget()))
+    {
+      if(it->second.users > 0)
+        {
+          it++;
+          continue;
+        }
+      glDeleteTextures(1, &it->second.texture);
+      it = shared->removeAtlas(it);
+    }
+  state->invalidate();
 }
 
 
 /*!
  * \brief RenderText::genTextures
  *
- * Create QString of characters to load into textures
+ * Create QString of characters to load into textures,
+ * all printable ASCII, so labels added with
+ * \fn addLabel() can hold any text.
  */
 void RenderText::genTextures()
 {
-  QString c = "0123456789,-e";
+  QString c;
+  for(char ch = 32; ch < 127; ch++)
+    c.append(QChar(ch));
   createQCharacters(c);
 }
 
 
+/*!
+ * \brief RenderText::atlasFonts
+ * \param qfont regular font of labels
+ * \param qfont_bold bold font of labels
+ */
+void RenderText::atlasFonts(QFont &qfont, QFont &qfont_bold)
+{
+  qfont.setStyleStrategy(QFont::PreferAntialias);
+  qfont.setPointSize(9);
+//  qfont.setPixelSize(12);
+
+  qfont_bold = qfont;
+  qfont_bold.setBold(true);
+}
+
+
+/*!
+ * \brief RenderText::atlasCell
+ * \param q_str characters of atlas
+ * \param width width of cell in logical pixels
+ * \param height height of cell in logical pixels
+ *
+ * Cell is wide enough for every glyph of both layers.
+ */
+void RenderText::atlasCell(const QString &q_str, uint &width, uint &height)
+{
+  QFont qfont;
+  QFont qfont_bold;
+  atlasFonts(qfont, qfont_bold);
+  QFontMetrics qftmetrics(qfont);
+  QFontMetrics qftmetrics_bold(qfont_bold);
+
+  width = 0;
+  for(QString::const_iterator c = q_str.begin(); c != q_str.end(); c++)
+    width = std::max(width, static_cast<uint>(std::max(qftmetrics.horizontalAdvance(*c),
+                                                       qftmetrics_bold.horizontalAdvance(*c))));
+  height = qftmetrics.height();
+}
+
+
 /*!
  * \brief Plot::createQCharacter
  * \param q_str QString of charactes to load into textures,
  *    see \brief genTextures
  *
  * Example of how to load glyphs into textures atlas using QPainter.
- * Create qrey colored QImage and paint characters into it.
- * Then create textures and load pixels from QImage.
- * Remember that Qt use AGRB format of images, so only
- * every 4 pixel need to be packed into texture.
+ * Glyph metrics are taken in logical pixels, so layout
+ * doesn't depend on device pixel ratio, and only the atlas
+ * of current ratio is rasterized here, see \fn rasterizeAtlas().
+ * Atlases of other screens are rasterized on worker threads,
+ * so moving widget to another screen doesn't wait for them.
+ * Labels of axes are still measured with advance of digit.
  */
 void RenderText::createQCharacters(QString &q_str)
 {
-  Characters.reserve(q_str.length());
+  shared->Characters.reserve(q_str.length());
+  shared->atlasChars = q_str;
 
   QFont qfont;
-  qfont.setStyleStrategy(QFont::PreferAntialias);
-  qfont.setPointSize(9);
-//  qfont.setPixelSize(12);
-
+  QFont qfont_bold;
+  atlasFonts(qfont, qfont_bold);
   QFontMetrics qftmetrics(qfont);
+  QFontMetrics qftmetrics_bold(qfont_bold);
 
-  uint width =  qftmetrics.horizontalAdvance(q_str[0]);
-  uint height = qftmetrics.height();
-
-  characterWidth = width;
-  characterHeight = height;
+  uint width = 0;
+  uint height = 0;
+  atlasCell(q_str, width, height);
 
-  QImage qimg(width * q_str.size(), height, QImage::Format_Grayscale8);
+  shared->characterWidth = qftmetrics.horizontalAdvance(QChar('0'));
+  shared->characterHeight = height;
 
-  QPainter qpaint(&qimg);
-  qpaint.setFont(qfont);
-  qpaint.setBrush(Qt::white);
-  qpaint.setPen(Qt::white);
-  qpaint.setRenderHint(QPainter::TextAntialiasing, true);
-  qpaint.setRenderHint(QPainter::SmoothPixmapTransform, true);
-  qpaint.fillRect(0, 0, width * q_str.size(), height, Qt::black);
-
-  texAtlas.cols = q_str.size();
-  texAtlas.rows = 1;
-  texAtlas.colFactor = 1/static_cast<GLdouble>(texAtlas.cols);
-  texAtlas.rowFactor = 1/static_cast<GLdouble>(texAtlas.rows);
+  // the last cell is solid, chrome is drawn from it
+  shared->texAtlas.cols = q_str.size() + 1;
+  shared->texAtlas.rows = 1;
+  shared->texAtlas.colFactor = 1/static_cast<GLdouble>(shared->texAtlas.cols);
+  shared->texAtlas.rowFactor = 1/static_cast<GLdouble>(shared->texAtlas.rows);
   int curr_row = 0;
 
   for(QString::Iterator c = q_str.begin(); c != q_str.end(); c++)
     {
       char ch = QString(*c).toLocal8Bit().front();
-      qpaint.drawText((curr_row * width) - qftmetrics.leftBearing(*c),
-                      height - qftmetrics.descent(), (*c));
 
       Character character = {
         width,
@@ -568,35 +1769,240 @@ void RenderText::createQCharacters(QString &q_str)
         qftmetrics.leftBearing(*c),
         qftmetrics.ascent(),
         qftmetrics.horizontalAdvance(*c),
-        (curr_row * texAtlas.colFactor),
+        qftmetrics_bold.leftBearing(*c),
+        qftmetrics_bold.horizontalAdvance(*c),
+        (curr_row * shared->texAtlas.colFactor),
         0.0,
       };
 
-      Characters.insert(std::pair<char, Character>(ch, character));
+      shared->Characters.insert(std::pair<char, Character>(ch, character));
       curr_row++;
     }
 
-  glGenTextures(1, &Texture);
-  glBindTexture(GL_TEXTURE_2D, Texture);
+  AtlasImages images = rasterizeAtlas(q_str, deviceScale);
+  shared->addAtlas(TextResources::scaleKey(deviceScale), uploadAtlas(images), TextResources::imageBytes(images));
+
+  QList<QScreen *> screens = QGuiApplication::screens();
+  for(int i = 0; i < screens.size(); i++)
+    requestAtlas(screens[i]->devicePixelRatio());
+}
+
+
+/*!
+ * \brief RenderText::rasterizeAtlas
+ * \param q_str characters to paint
+ * \param scale device pixel ratio
+ * \return regular and bold layer of atlas
+ *
+ * Create qrey colored QImage and paint characters into it.
+ * Cell is \param scale times larger than in logical pixels,
+ * rounded up, so one texel is one device pixel and text
+ * is sharp on HiDPI screens. Touches no OpenGL state,
+ * so can run on any thread.
+ */
+AtlasImages RenderText::rasterizeAtlas(QString q_str, double scale)
+{
+  TRACE_ZONE("atlas rasterize");
+  uint width = 0;
+  uint height = 0;
+  atlasCell(q_str, width, height);
+
+  QFont qfont;
+  QFont qfont_bold;
+  atlasFonts(qfont, qfont_bold);
+
+  AtlasImages images;
+  images.cellWidth = TextLayout::cellTexels(width, scale);
+  images.cellHeight = TextLayout::cellTexels(height, scale);
+  images.regular = QImage(images.cellWidth * (q_str.size() + 1), images.cellHeight, QImage::Format_Grayscale8);
+  images.bold = QImage(images.cellWidth * (q_str.size() + 1), images.cellHeight, QImage::Format_Grayscale8);
+  paintCharacters(images.regular, qfont, q_str, images.cellWidth, height, scale);
+  paintCharacters(images.bold, qfont_bold, q_str, images.cellWidth, height, scale);
+  return images;
+}
+
+
+/*!
+ * \brief RenderText::uploadAtlas
+ * \param images layers of atlas from \fn rasterizeAtlas()
+ * \return texture array with regular glyphs in layer 0
+ *    and bold ones in layer 1
+ *
+ * Then create textures and load pixels from QImage.
+ * Atlas is a texture array, regular glyphs are in layer 0
+ * and bold ones in layer 1 at the same place, so style
+ * of label only selects layer in its vertices.
+ */
+GLuint RenderText::uploadAtlas(const AtlasImages &images)
+{
+  TRACE_ZONE("atlas upload");
+  GLsizei width = images.regular.width();
+  GLsizei height = images.regular.height();
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
   glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
 
-  glTexImage2D(
-        GL_TEXTURE_2D,
+  glTexImage3D(
+        GL_TEXTURE_2D_ARRAY,
         0,
         GL_RED,
-        width * q_str.size(),
+        width,
         height,
+        2,
         0,
         GL_RED,
         GL_UNSIGNED_BYTE,
-        qimg.constBits());
+        NULL);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, width, height, 1,
+                  GL_RED, GL_UNSIGNED_BYTE, images.regular.constBits());
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 1, width, height, 1,
+                  GL_RED, GL_UNSIGNED_BYTE, images.bold.constBits());
+
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  state->invalidate();
+  return texture;
+}
+
+
+/*!
+ * \brief RenderText::requestAtlas
+ * \param scale device pixel ratio to rasterize atlas for
+ *
+ * Start rasterizing atlas on worker thread, unless it's
+ * cached or rasterized already.
+ */
+void RenderText::requestAtlas(double scale)
+{
+  int key = TextResources::scaleKey(scale);
+  if((shared->atlases.count(key) != 0) || (shared->pendingAtlases.count(key) != 0))
+    return;
+
+  shared->pendingAtlases[key] = std::async(std::launch::async, &RenderText::rasterizeAtlas,
+                                           shared->atlasChars, scale);
+}
+
+
+/*!
+ * \brief RenderText::selectAtlas
+ *
+ * Take atlas of current device pixel ratio. If it's
+ * not rasterized yet, previous atlas, or any loaded one
+ * if there is none, is used and widget is asked to
+ * repaint, until atlas from worker thread is ready and
+ * only loaded to texture here. Renderer is a user of
+ * the atlas it draws with, see \var AtlasTexture::users.
+ */
+void RenderText::selectAtlas()
+{
+  int key = TextResources::scaleKey(deviceScale);
+  if(key == atlasKey)
+    return;
+
+  std::unordered_map<int, AtlasTexture>::iterator it = shared->atlases.find(key);
+  if(it == shared->atlases.end())
+    {
+      std::unordered_map<int, std::future<AtlasImages> >::iterator pending = shared->pendingAtlases.find(key);
+      if(pending == shared->pendingAtlases.end())
+        {
+          requestAtlas(deviceScale);
+          pending = shared->pendingAtlases.find(key);
+        }
+
+      if(pending->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+          if(repaint)
+            repaint();
+          if((atlasKey < 0) && !shared->atlases.empty())
+            {
+              // fallback is counted as used too, so no widget evicts it meanwhile
+              it = shared->atlases.begin();
+              it->second.users++;
+              atlasKey = it->first;
+              atlasTexture = it->second.texture;
+            }
+          return;
+        }
+
+      AtlasImages images = pending->second.get();
+      shared->pendingAtlases.erase(pending);
+      it = shared->addAtlas(key, uploadAtlas(images), TextResources::imageBytes(images));
+      budgetDirty = true;
+    }
+
+  if(atlasKey >= 0)
+    shared->atlases[atlasKey].users--;
+  it->second.users++;
+  atlasKey = key;
+  atlasTexture = it->second.texture;
+  invalidateLayers();
+}
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+/*!
+ * \brief RenderText::setDevicePixelRatio
+ * \param ratio device pixel ratio of widget
+ *
+ * Atlas of \param ratio is taken at the next render.
+ * Glyphs are hinted to device pixels, so text is laid
+ * out again when ratio changes.
+ */
+void RenderText::setDevicePixelRatio(double ratio)
+{
+  if(ratio == deviceScale)
+    return;
+
+  deviceScale = ratio;
+  labelLayout.setDeviceScale(ratio);
+  matrixLabels.setDeviceScale(ratio);
+  labelsRelayout = true;
+  if(builder)
+    updateTextPositions();
+}
+
+
+/*!
+ * \brief RenderText::paintCharacters
+ * \param qimg image of atlas layer, one cell per character
+ * \param qfont font of layer
+ * \param q_str characters to paint
+ * \param width width of cell in texels
+ * \param height height of cell in logical pixels
+ * \param scale device pixel ratio, glyphs are scaled by it
+ *
+ * Cell after the last character is filled solid.
+ */
+void RenderText::paintCharacters(QImage &qimg, const QFont &qfont, const QString &q_str,
+                                 uint width, uint height, double scale)
+{
+  QFontMetrics qftmetrics(qfont);
+
+  QPainter qpaint(&qimg);
+  qpaint.setFont(qfont);
+  qpaint.setBrush(Qt::white);
+  qpaint.setPen(Qt::white);
+  qpaint.setRenderHint(QPainter::TextAntialiasing, true);
+  qpaint.setRenderHint(QPainter::SmoothPixmapTransform, true);
+  qpaint.fillRect(0, 0, qimg.width(), qimg.height(), Qt::black);
+
+  int curr_row = 0;
+  for(QString::const_iterator c = q_str.begin(); c != q_str.end(); c++)
+    {
+      // every cell starts at whole texel, glyph is painted in logical pixels
+      qpaint.resetTransform();
+      qpaint.translate(curr_row * width, 0);
+      qpaint.scale(scale, scale);
+      qpaint.drawText(QPointF(-qftmetrics.leftBearing(*c), height - qftmetrics.descent()), QString(*c));
+      curr_row++;
+    }
+  qpaint.resetTransform();
+  qpaint.fillRect(curr_row * width, 0, width, qimg.height(), Qt::white);
 }
 
 
@@ -614,19 +2020,22 @@ void RenderText::createQCharacters(QString &q_str)
  */
 void RenderText::renderTextEasy(double number, double xi, double yi, Arrange ar)
 {
+  const Proj &proj = metrics.getProjMatrix();
+  double pixelWidth = metrics.getPixelWidth();
+  double pixelHeight = metrics.getPixelHeight();
   std::vector<Character> print_characters;
   std::vector<char> num_vec;
   print_characters.reserve(MAX_CH);
 
   GLfloat tex_width = 0;
-  getCharFromFloat(&num_vec, number);
+  TextLayout::getCharFromFloat(&num_vec, number);
   std::unordered_map<char, Character>::iterator it;
   double offy = 0;
 
   for( uint c = 0; c < num_vec.size(); c++)
     {
-      it = Characters.find(num_vec[c]);
-      if(it != Characters.end())
+      it = shared->Characters.find(num_vec[c]);
+      if(it != shared->Characters.end())
         {
           print_characters.push_back(it->second);
           tex_width += it->second.Advance * pixelWidth;
@@ -636,12 +2045,12 @@ void RenderText::renderTextEasy(double number, double xi, double yi, Arrange ar)
 
   if(print_characters.size() == 0) return;
 
-  if(ar == horizontal)
+  if(ar == TextLayout::horizontal)
     {
       xi -= tex_width / 2;                                // make text texture to be in the center of the position in x_axis
       yi = proj.bottom + (pixelHeight * 1);
     }
-  if(ar == vertical)
+  if(ar == TextLayout::vertical)
     {
       xi = proj.left + (pixelWidth * 4);
       yi -= offy;     // make y_axis text texture to be in the center of position
@@ -650,17 +2059,16 @@ void RenderText::renderTextEasy(double number, double xi, double yi, Arrange ar)
   // we need to make sure that the edge of a texture
   // will always be in the edge of a pixel
   // so the rendered text won't look fuzzy
-  double x = hintToPixel(xi, pixelWidth);
-  double y = hintToPixel(yi, pixelHeight);
-
-  glUseProgram(text_prog);
-  glActiveTexture(GL_TEXTURE0);
-  glBindVertexArray(text_VAO);
-  glEnableClientState(GL_VERTEX_ARRAY);
+  double x = TextLayout::hintToPixel(xi, pixelWidth) - originX;
+  double y = TextLayout::hintToPixel(yi, pixelHeight) - originY;
+
+  state->useProgram(shared->text_prog);
+  glUniformMatrix4fv(shared->text_matrix, 1, GL_FALSE, &projMatrix[0][0]);
+  state->bindTexture(GL_TEXTURE0, atlasTexture, GL_TEXTURE_2D_ARRAY);
+  state->bindVertexArray(text_VAO);
+  state->bindArrayBuffer(text_VBO);
   GLdouble yposH = y + (print_characters[0].sizey * pixelHeight);
 
-  glBindTexture(GL_TEXTURE_2D,Texture);
-
   for(uint i = 0; i < print_characters.size(); i++)
     {
       GLdouble xpos = x + print_characters[i].BearingX * pixelWidth;    // render glyph considering it's horizontal shift
@@ -670,7 +2078,7 @@ void RenderText::renderTextEasy(double number, double xi, double yi, Arrange ar)
       GLdouble w = print_characters[i].sizex * pixelWidth;  // width of space for glyph to render
 
       // render glyph using triangles
-      // buffer is packed [Screen X, Screen Y, Tex X, Tex Y] x6
+      // buffer is packed \struct GlyphVertex x6
       // Screen coords:
       // 0---*    3---5
       // | \ |    | \ |
@@ -679,25 +2087,26 @@ void RenderText::renderTextEasy(double number, double xi, double yi, Arrange ar)
       // 1---2    *---4
       // | / |    | / |
       // 0---*    3---5
-      GLdouble vertices[6][4] = {
-        {xpos,     yposH, texposx,                      texposy},
-        {xpos,     y,     texposx,                      texposy + texAtlas.rowFactor},
-        {xpos + w, y,     texposx + texAtlas.colFactor, texposy + texAtlas.rowFactor},
-
-        {xpos,     yposH, texposx,                      texposy},
-        {xpos + w, y,     texposx + texAtlas.colFactor, texposy + texAtlas.rowFactor},
-        {xpos + w, yposH, texposx + texAtlas.colFactor, texposy}
-      };
+      GLdouble col = shared->texAtlas.colFactor;
+      GLdouble row = shared->texAtlas.rowFactor;
+      GlyphVertex vertices[6];
+      TextLayout::setVertex(vertices[0], xpos,     yposH, texposx,       texposy,       defaultTextStyle);
+      TextLayout::setVertex(vertices[1], xpos,     y,     texposx,       texposy + row, defaultTextStyle);
+      TextLayout::setVertex(vertices[2], xpos + w, y,     texposx + col, texposy + row, defaultTextStyle);
+
+      TextLayout::setVertex(vertices[3], xpos,     yposH, texposx,       texposy,       defaultTextStyle);
+      TextLayout::setVertex(vertices[4], xpos + w, y,     texposx + col, texposy + row, defaultTextStyle);
+      TextLayout::setVertex(vertices[5], xpos + w, yposH, texposx + col, texposy,       defaultTextStyle);
 
-      glBindBuffer(GL_ARRAY_BUFFER, text_VBO);
       glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-      glBindBuffer(GL_ARRAY_BUFFER, 0);
+      state->countUpload(sizeof(vertices));
 
       glDrawArrays(GL_TRIANGLES, 0, 6);
+      state->countDraw();
       x += (print_characters[i].Advance) * pixelWidth;
     }
 
-  glBindVertexArray(0);
-  glBindTexture(GL_TEXTURE_2D, 0);
-  glDisableClientState(GL_VERTEX_ARRAY);
+  // glyphs were loaded over labels
+  streamDirty = true;
+  batchLoaded = false;
 }
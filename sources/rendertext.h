@@ -2,75 +2,88 @@
 #define RENDERTEXT_H
 
 #include <QOpenGLFunctions_3_3_Core>
+#include <QImage>
+#include <QFont>
+#include <QScreen>
+#include <QGuiApplication>
 
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <functional>
+#include <future>
+#include <string>
+#include <stdint.h>
 
+#include "shaderprogram.h"
+#include "textresources.h"
+#include "textlayout.h"
+#include "textmetrics.h"
+#include "framebuilder.h"
+#include "matrixlabels.h"
+#include "glstate.h"
+#include "slotallocator.h"
 
+#define LABEL_SLOT_GLYPHS 32      ///< Glyphs one label holds, longer text is cut
+#define LABEL_SLOT_BITS 20        ///< Low bits of \typedef LabelId that hold slot, the rest hold generation
+#define INVALID_LABEL 0xFFFFFFFFu ///< Id returned when label couldn't be added
+#define TEXT_ORIGIN_SPAN 16       ///< Views text origin is kept for while view moves away from it
+#define TEXT_BUDGET_GROWTH 4      ///< Over budget, memory is compacted again after it grows by 1/4 of it
 
-struct Proj
+
+typedef uint32_t LabelId;
+
+
+struct TextMemory
 {
-  float left;
-  float right;
-  float bottom;
-  float top;
+  size_t labelBytes;      ///< Retained labels, their text and copy of their vertices
+  size_t layoutBytes;     ///< Layouts with their glyph metrics, and frames of worker thread
+  size_t matrixBytes;     ///< Slots of matrix labels
+  size_t bufferBytes;     ///< Vertex buffers, on GPU
+  size_t layerBytes;      ///< Textures of cached label layers, on GPU
+  size_t atlasBytes;      ///< Glyph atlases on GPU, shared by all renderers of share group
+  size_t cpuBytes;        ///< Sum of CPU parts
+  size_t gpuBytes;        ///< Sum of GPU parts, atlases included
 };
 
 
 class RenderText : protected QOpenGLFunctions_3_3_Core
 {
 
-  enum Arrange
-  {
-    horizontal,
-    vertical
-  };
-
-
-  struct CHPrintInfo
-  {
-    uint Bearing;
-    uint Advance;
-    GLdouble texX;
-    GLdouble texY;
-  };
+  typedef TextLayout::Arrange Arrange;
 
-  struct Text
+  struct Label
   {
-    double num;
-    std::vector<char> print;
-    std::vector<CHPrintInfo>printInfo;
-    std::vector<GLdouble> pos;
-    Arrange ar;
-    double width;
-    double height;
+    std::string text;
+    double x;             ///< Left edge of text in values of projection matrix
+    double y;             ///< Bottom edge of text
+    TextStyle style;
+    TextAnchor anchor;    ///< Rotation and alignment of text around \var x, \var y
+    unsigned generation;  ///< Changes every time slot is released, so stale ids are refused
+    bool alive;
+    bool dirty;           ///< Slot is queued in \var dirtyLabels
   };
 
-  struct TexAtlas   // in work
+  struct Layer
   {
-    GLint rows;
-    GLint cols;
-    GLdouble rowFactor;
-    GLdouble colFactor;
-  };
-
-
-  struct Character
-  {
-    GLuint sizex;
-    GLuint sizey;
-    GLint BearingX;
-    GLint BearingY;
-    GLint Advance;
-    GLdouble texX;
-    GLdouble texY;
+    GLint first;          ///< First vertex of the layer in \var text_VBO
+    GLsizei count;        ///< Number of vertices of the layer
+    unsigned version;     ///< Version of layer in the current frame
+    bool changed;         ///< Labels or their pixel positions changed since the last render
+    int stableFrames;     ///< Renders since the last change, up to LAYER_STATIC_FRAMES
+    bool cached;          ///< \var texture holds the layer as it is now
+    GLuint fbo;           ///< Framebuffer object layer is rendered to
+    GLuint texture;       ///< Layer rendered with premultiplied alpha, size of viewport
+    GLsizei texWidth;
+    GLsizei texHeight;
   };
 
 public:
   explicit RenderText();
   ~RenderText();
 
-  void initTextRender();
+  void initTextRender(GLState *glstate, std::function<void()> frameReady);
+  void releaseTextRender();
   void reserveSpace(int width, int height);
 
   int createShader(const char* vertex, const char* fragment);
@@ -78,73 +91,193 @@ public:
 
   void createCharacter(GLbyte ch);
   void createQCharacters(QString &q_str);
+  static AtlasImages rasterizeAtlas(QString q_str, double scale);
+  static void paintCharacters(QImage &qimg, const QFont &qfont, const QString &q_str,
+                              uint width, uint height, double scale);
+  GLuint uploadAtlas(const AtlasImages &images);
+  void setDevicePixelRatio(double ratio);
 
 
   void updateShaderMatrix();
   void updateTextPositions();
+  void waitLayout();
 
-  void getCharFromFloat(std::vector<char> *number, double input);
   void renderTextEasy(double number, double xi, double yi, Arrange ar);
   void renderText();
-
-  double hintToPixel(double num, double pixelsize);
+  void renderChrome();
+  void renderLabels();
+  void renderBatch(const std::vector<GlyphVertex> &vertices, bool changed, size_t loaded = 0);
+  void setupLayout(TextLayout &layout);
 
   inline void setPixelHeight(double height);
   inline void setPixelWidth(double width);
   void setProjMatrix(Proj &pr);
+  void setPlotArea(const Proj &area);
 
   inline double getPixelHeight();
   inline double getPixelWidth();
+  inline int getCharacterWidth();
+  inline int getCharacterHeight();
+  inline int getTextMaxWidth();
   Proj getProjMatrix();
+  inline const TextMetrics &getMetrics();
 
-  void setText(std::vector<double> &y, std::vector<double> &x);
+  int measureText(double num);
 
+  void setText(const std::vector<double> &y, const std::vector<double> &x);
+  void setLabelStyle(double value, TextLayout::Arrange ar, const TextStyle &style);
+  void clearLabelStyles();
+  void invalidateLayers();
 
-private:
-  Proj proj;               ///< Holds projection matrix values
+  LabelId addLabel(const std::string &text, double x, double y, const TextStyle &style,
+                   const TextAnchor &anchor = defaultAnchor);
+  LabelId addLabel(double value, double x, double y, const TextStyle &style,
+                   const TextAnchor &anchor = defaultAnchor);
+  bool updateLabel(LabelId id, const std::string &text, double x, double y, const TextStyle &style,
+                   const TextAnchor &anchor = defaultAnchor);
+  bool moveLabel(LabelId id, double x, double y);
+  bool removeLabel(LabelId id);
+  int measureString(const std::string &text, const TextStyle &style);
 
+  void setMatrix(const double *values, size_t rows, size_t columns, size_t stride, const Proj &area);
+  void updateMatrixCell(size_t row, size_t column);
+  void updateMatrix();
+  void renderMatrix();
 
-  std::unordered_map<char, Character> Characters;  ///<
-  std::vector<Text> textBoxes;
+  TextMemory memoryUsage();
+  static TextMemory totalMemoryUsage();
+  void setMemoryBudget(size_t cpuBytes, size_t gpuBytes);
+  static void setAtlasBudget(size_t bytes);
 
-  TexAtlas texAtlas;      ///< Holds information about texture atlas
-  GLuint Texture;         ///< Texture atlas where all characters glyps is painted
 
-  GLuint text_prog;       ///< Shader program that used to render characters glyphs
+private:
+  void createGlyphArray(GLuint &vbo, GLuint &vao);
+  static void atlasFonts(QFont &qfont, QFont &qfont_bold);
+  static void atlasCell(const QString &q_str, uint &width, uint &height);
+  void requestAtlas(double scale);
+  void selectAtlas();
+  void updateOrigin();
+  void uploadFrame();
+  void cacheLayer(Layer &layer, int index);
+  Label *findLabel(LabelId id);
+  void touchLabel(size_t slot);
+  void layoutLabel(size_t slot);
+  void uploadLabels(size_t from, size_t to);
+  void uploadMatrix(size_t from, size_t to);
+  TextMemory account();
+  void checkBudget();
+  void compactCpu();
+  void compactGpu();
+  void trimAtlases();
+
+  TextMetrics metrics;     ///< Projection matrix, pixel sizes and label widths, needs no context
+  Proj plotArea;           ///< Part of widget data is drawn in, see \fn setPlotArea()
+
+
+  GLState *state;          ///< Bindings of widget context, shared with other renderers
+  std::shared_ptr<TextResources> shared;   ///< Program, atlas and glyph metrics shared by all widgets of context share group
+  std::unique_ptr<FrameBuilder> builder;   ///< Lays out labels on worker thread
+  std::function<void()> repaint;           ///< Asks widget to repaint, from any thread
+  double deviceScale;     ///< Device pixel ratio of widget
+  int atlasKey;           ///< Scale key of \var atlasTexture, -1 if none is taken yet
+  GLuint atlasTexture;    ///< Atlas of \var deviceScale, or the previous one while it's rasterized
+  const TextFrame *frame;  ///< The newest frame taken from \var builder, null until the first one
+  std::vector<double> labelsY;        ///< Labels of the next request to \var builder
+  std::vector<double> labelsX;
+  std::unordered_map<double, TextStyle> labelStyles[2];   ///< Styles of labels that aren't default, by value, indexed by \enum Arrange
+
+  double originX;          ///< Whole pixel text on GUI thread is placed relative to, see \fn updateOrigin()
+  double originY;
+  double originPixelWidth; ///< Pixel sizes \var originX and \var originY were hinted to
+  double originPixelHeight;
+  GLfloat projMatrix[4][4];     ///< Orthographic matrix of \var proj shifted by origin, used by labels, matrix and \fn renderTextEasy()
+  GLfloat frameMatrix[4][4];    ///< Orthographic matrix \var frame was laid out for, loaded before every render, since program is shared
   GLuint text_VBO;        ///< Vertex buffer object that holds screen and texture coordinates on where to render glyphs
   GLuint text_VAO;        ///< Vertex array object used to load values to compiled shader program
 
-  double pixelWidth;
-  double pixelHeight;
-  int textMaxWidth;
-  int textHeight;
-  int characterWidth;
-  int characterHeight;
-
+  bool streamDirty;       ///< Vertices of \var frame should be loaded again
+  bool batchLoaded;       ///< \var text_VBO holds vertices of the last \fn renderBatch()
+  Layer layers[2];        ///< Labels of each axis, indexed by \enum Arrange
+  GLuint layer_VBO;       ///< Quads that put cached layers on screen, 6 vertices per layer
+  GLuint layer_VAO;
+
+  TextLayout labelLayout;         ///< Lays out retained labels, on GUI thread
+  std::vector<Label> labels;      ///< Retained labels, indexed by slot
+  SlotAllocator labelSlots;
+  std::vector<GlyphVertex> labelVertices;   ///< Copy of \var label_VBO, LABEL_SLOT_GLYPHS quads per slot
+  std::vector<size_t> dirtyLabels;          ///< Slots to lay out and load before the next render
+  size_t labelBufferSlots;        ///< Slots \var label_VBO has room for
+  bool labelsRelayout;            ///< Pixel sizes changed, all slots are laid out and loaded again
+  double labelPixelWidth;         ///< Pixel sizes labels were laid out for
+  double labelPixelHeight;
+  GLuint label_VBO;
+  GLuint label_VAO;
+
+  MatrixLabels matrixLabels;      ///< Values of visible cells of matrix, on GUI thread
+  size_t matrixBufferSlots;       ///< Cells \var matrix_VBO has room for
+  GLuint matrix_VBO;
+  GLuint matrix_VAO;
+
+  size_t labelTextBytes;          ///< Characters of all retained labels
+  size_t textBufferBytes;         ///< Size of \var text_VBO
+  size_t cpuBudget;               ///< CPU bytes above which memory is compacted, 0 is unlimited
+  size_t gpuBudget;               ///< GPU bytes without atlases above which caches are evicted, 0 is unlimited
+  size_t cpuCompacted;            ///< CPU bytes after the last compaction
+  size_t gpuCompacted;
+  bool budgetDirty;               ///< Memory changed since it was accounted
+  bool compactLayout;             ///< The next layout request compacts layout of worker thread
+  bool layerCaching;              ///< Layers can be cached, false after they were evicted over budget
+  TextMemory reported;            ///< Usage added to \var allRenderers at the last \fn account()
+
+  static TextMemory allRenderers; ///< Usage of all renderers, without atlases
 };
 
 
 inline void RenderText::setPixelHeight(double height)
 {
-  pixelHeight = height;
+  metrics.setPixelHeight(height);
 }
 
 
 inline void RenderText::setPixelWidth(double width)
 {
-  pixelWidth = width;
+  metrics.setPixelWidth(width);
 }
 
 
 inline double RenderText::getPixelHeight()
 {
-  return pixelHeight;
+  return metrics.getPixelHeight();
 }
 
 
 inline double RenderText::getPixelWidth()
 {
-  return pixelWidth;
+  return metrics.getPixelWidth();
+}
+
+
+inline int RenderText::getCharacterWidth()
+{
+  return metrics.getCharacterWidth();
+}
+
+
+inline int RenderText::getCharacterHeight()
+{
+  return metrics.getCharacterHeight();
+}
+
+
+inline int RenderText::getTextMaxWidth()
+{
+  return metrics.getTextMaxWidth();
+}
+
+
+inline const TextMetrics &RenderText::getMetrics()
+{
+  return metrics;
 }
 
 
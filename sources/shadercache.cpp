@@ -0,0 +1,163 @@
+#include "shadercache.h"
+#include <string.h>
+
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSaveFile>
+#include <QFile>
+#include <QDir>
+
+
+#define CACHE_MAGIC "GLPB"      ///< First bytes of every cached program file
+
+
+/*!
+ * \brief programCachePath
+ * \param gl OpenGL functions of current context
+ * \param vertex vertex shader source
+ * \param fragment fragment shader source
+ * \return file where binary of the program is cached, empty if it can't be cached
+ *
+ * Binaries are valid only for the driver that created them,
+ * so file name is a hash of vendor, renderer and version
+ * strings together with shader sources. Program binaries
+ * need OpenGL 4.1 or GL_ARB_get_program_binary, which
+ * Mesa has, and at least one binary format.
+ */
+QString programCachePath(QOpenGLFunctions_3_3_Core *gl, const char* vertex, const char* fragment)
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if(context == nullptr)
+    return QString();
+
+  QSurfaceFormat format = context->format();
+  bool supported = (format.majorVersion() > 4) ||
+                   ((format.majorVersion() == 4) && (format.minorVersion() >= 1)) ||
+                   context->hasExtension("GL_ARB_get_program_binary");
+  if(!supported)
+    return QString();
+
+  GLint formats = 0;
+  gl->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  if(formats <= 0)
+    return QString();
+
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  const GLenum names[3] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+  for(int i = 0; i < 3; i++)
+    {
+      const char *str = reinterpret_cast<const char *>(gl->glGetString(names[i]));
+      if(str != nullptr)
+        hash.addData(str, strlen(str));
+      hash.addData("\n", 1);
+    }
+  hash.addData(vertex, strlen(vertex));
+  hash.addData("\n", 1);
+  hash.addData(fragment, strlen(fragment));
+
+  QString dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+  if(dir.isEmpty())
+    return QString();
+  dir += "/shaders";
+  if(!QDir(dir).mkpath("."))
+    return QString();
+
+  return dir + "/" + QString::fromLatin1(hash.result().toHex().constData()) + ".bin";
+}
+
+
+/*!
+ * \brief prepareProgramBinary
+ * \param program not linked yet program
+ *
+ * Ask driver to keep binary of the program after link,
+ * so it can be saved with \fn saveProgramBinary().
+ * Should be called before \fn glLinkProgram().
+ */
+void prepareProgramBinary(GLuint program)
+{
+  QOpenGLExtraFunctions *extra = QOpenGLContext::currentContext()->extraFunctions();
+  extra->glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+
+/*!
+ * \brief loadProgramBinary
+ * \param gl OpenGL functions of current context
+ * \param path file from \fn programCachePath()
+ * \return linked program, 0 if there is no valid binary
+ *
+ * Driver can refuse the binary even if the key matched,
+ * e.g. after update with the same version string.
+ * Such file is removed, so program is compiled and
+ * cached again.
+ */
+GLuint loadProgramBinary(QOpenGLFunctions_3_3_Core *gl, const QString &path)
+{
+  QFile file(path);
+  if(!file.open(QIODevice::ReadOnly))
+    return 0;
+
+  QByteArray data = file.readAll();
+  file.close();
+
+  int header = sizeof(CACHE_MAGIC) - 1 + sizeof(quint32);
+  if((data.size() <= header) || (memcmp(data.constData(), CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1) != 0))
+    {
+      QFile::remove(path);
+      return 0;
+    }
+
+  quint32 format = 0;
+  memcpy(&format, data.constData() + sizeof(CACHE_MAGIC) - 1, sizeof(quint32));
+
+  QOpenGLExtraFunctions *extra = QOpenGLContext::currentContext()->extraFunctions();
+  GLuint program = gl->glCreateProgram();
+  extra->glProgramBinary(program, format, data.constData() + header, data.size() - header);
+
+  GLint state = 0;
+  gl->glGetProgramiv(program, GL_LINK_STATUS, &state);
+  if(state == GL_FALSE)
+    {
+      gl->glDeleteProgram(program);
+      QFile::remove(path);
+      return 0;
+    }
+
+  return program;
+}
+
+
+/*!
+ * \brief saveProgramBinary
+ * \param gl OpenGL functions of current context
+ * \param program linked program, see \fn prepareProgramBinary()
+ * \param path file from \fn programCachePath()
+ *
+ * File is written to a temporary one and renamed,
+ * so other process never reads half of it.
+ */
+void saveProgramBinary(QOpenGLFunctions_3_3_Core *gl, GLuint program, const QString &path)
+{
+  GLint length = 0;
+  gl->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if(length <= 0)
+    return;
+
+  QByteArray binary;
+  binary.resize(length);
+  GLenum format = 0;
+  QOpenGLExtraFunctions *extra = QOpenGLContext::currentContext()->extraFunctions();
+  extra->glGetProgramBinary(program, length, &length, &format, binary.data());
+
+  quint32 header = format;
+  QSaveFile file(path);
+  if(!file.open(QIODevice::WriteOnly))
+    return;
+  file.write(CACHE_MAGIC, sizeof(CACHE_MAGIC) - 1);
+  file.write(reinterpret_cast<const char *>(&header), sizeof(quint32));
+  file.write(binary.constData(), length);
+  file.commit();
+}
@@ -0,0 +1,14 @@
+#ifndef SHADERCACHE_H
+#define SHADERCACHE_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QString>
+
+
+QString programCachePath(QOpenGLFunctions_3_3_Core *gl, const char* vertex, const char* fragment);
+void prepareProgramBinary(GLuint program);
+GLuint loadProgramBinary(QOpenGLFunctions_3_3_Core *gl, const QString &path);
+void saveProgramBinary(QOpenGLFunctions_3_3_Core *gl, GLuint program, const QString &path);
+
+
+#endif // SHADERCACHE_H
@@ -0,0 +1,113 @@
+#include "shaderprogram.h"
+#include "shadercache.h"
+#include <stdio.h>
+
+
+/*!
+ * \brief createShaderProgram
+ * \param gl OpenGL functions of current context
+ * \param vertexShader
+ * \param fragmentShader
+ * \return compiled shader program
+ *
+ * Compile passed OpenGL shaders to OpenGL program.
+ * Use compiled program to update uniforms and load needed
+ * vertex array objects (if OpenGl version supports it) with
+ * value to pass to shaders. To do so, you need to use
+ * \fn glUseProgram(...) with returned variable and \fn glBindVertexArray()
+ * to change buffer without the need to change values, or \fn glUniform()
+ * with the name of uniform to update it's values.
+ * Linked program is cached on disk when driver supports
+ * program binaries, next start loads it instead of compiling.
+ */
+GLuint createShaderProgram(QOpenGLFunctions_3_3_Core *gl, const char* vertexShader, const char* fragmentShader)
+{
+  QString cachePath = programCachePath(gl, vertexShader, fragmentShader);
+  if(!cachePath.isEmpty())
+    {
+      GLuint cached = loadProgramBinary(gl, cachePath);
+      if(cached != 0)
+        return cached;
+    }
+
+  GLint state = 0;
+  GLint loglen = 0;
+
+  GLuint vertex = gl->glCreateShader(GL_VERTEX_SHADER);
+  gl->glShaderSource(vertex, 1, &vertexShader, NULL);
+  gl->glCompileShader(vertex);
+  gl->glGetShaderiv(vertex, GL_COMPILE_STATUS, &state);
+  if(state == GL_FALSE)
+    {
+      gl->glGetShaderiv(vertex, GL_INFO_LOG_LENGTH, &loglen);
+      GLchar *infolog = new GLchar[loglen];
+      gl->glGetShaderInfoLog(vertex, loglen, NULL, infolog);
+      printf("vertex shader failed, %s\n", infolog);
+      delete[] infolog;
+    }
+
+  GLuint fragment = gl->glCreateShader(GL_FRAGMENT_SHADER);
+  gl->glShaderSource(fragment, 1, &fragmentShader, NULL);
+  gl->glCompileShader(fragment);
+  gl->glGetShaderiv(fragment, GL_COMPILE_STATUS, &state);
+  if(state == GL_FALSE)
+    {
+      gl->glGetShaderiv(fragment, GL_INFO_LOG_LENGTH, &loglen);
+      GLchar *infolog = new GLchar[loglen];
+      gl->glGetShaderInfoLog(fragment, loglen, NULL, infolog);
+      printf("fragment shader failed, %s\n", infolog);
+      delete[] infolog;
+    }
+
+  GLuint program = gl->glCreateProgram();
+  gl->glAttachShader(program, vertex);
+  gl->glAttachShader(program, fragment);
+  if(!cachePath.isEmpty())
+    prepareProgramBinary(program);
+  gl->glLinkProgram(program);
+  gl->glGetProgramiv(program, GL_LINK_STATUS, &state);
+  if(state == GL_FALSE)
+    {
+      gl->glGetProgramiv(program, GL_INFO_LOG_LENGTH, &loglen);
+      GLchar *infolog = new GLchar[loglen];
+      gl->glGetProgramInfoLog(program, loglen, NULL, infolog);
+      printf("program shader link failed, %s\n", infolog);
+      delete[] infolog;
+    }
+  else if(!cachePath.isEmpty())
+    {
+      saveProgramBinary(gl, program, cachePath);
+    }
+
+  gl->glDeleteShader(vertex);
+  gl->glDeleteShader(fragment);
+
+  return program;
+}
+
+
+/*!
+ * \brief orthoMatrix
+ * \param pr projection matrix values
+ * \param matrix orthographic matrix to load to shaders
+ *
+ * Every renderer takes the same matrix from the same
+ * \struct Proj, so text hinted to pixels stays
+ * aligned with everything else on the scene.
+ */
+void orthoMatrix(const Proj &pr, GLfloat matrix[4][4])
+{
+  // computed in double, only the result is rounded to floats
+  double proj_matrix[4][4] = {
+    { 2/(pr.right - pr.left),            0,               0,        0 },
+    {              0,             2/(pr.top - pr.bottom), 0,        0 },
+    {              0,                        0,              -2/(-1-1.0), 0 },
+    { -(pr.right + pr.left)/(pr.right - pr.left),
+      -(pr.top + pr.bottom)/(pr.top - pr.bottom),
+      -(-1+1)/(-1-1.0), 1   }
+  };
+
+  for(int i = 0; i < 4; i++)
+    for(int j = 0; j < 4; j++)
+      matrix[i][j] = static_cast<GLfloat>(proj_matrix[i][j]);
+}
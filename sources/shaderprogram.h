@@ -0,0 +1,22 @@
+#ifndef SHADERPROGRAM_H
+#define SHADERPROGRAM_H
+
+#include <QOpenGLFunctions_3_3_Core>
+
+#include "layouttypes.h"
+
+
+struct Clip
+{
+  GLint x;
+  GLint y;
+  GLsizei width;
+  GLsizei height;
+};
+
+
+GLuint createShaderProgram(QOpenGLFunctions_3_3_Core *gl, const char* vertex, const char* fragment);
+void orthoMatrix(const Proj &pr, GLfloat matrix[4][4]);
+
+
+#endif // SHADERPROGRAM_H
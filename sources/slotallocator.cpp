@@ -0,0 +1,80 @@
+#include "slotallocator.h"
+#include <algorithm>
+
+
+SlotAllocator::SlotAllocator()
+{
+  next = 0;
+  count = 0;
+}
+
+
+SlotAllocator::~SlotAllocator()
+{
+
+}
+
+
+/*!
+ * \brief SlotAllocator::allocate
+ * \return index of free slot
+ *
+ * Released slot is reused if there is one, otherwise
+ * a new one is taken after \fn highWater(). O(1).
+ */
+size_t SlotAllocator::allocate()
+{
+  count++;
+  if(!freeSlots.empty())
+    {
+      size_t slot = freeSlots.back();
+      freeSlots.pop_back();
+      return slot;
+    }
+  return next++;
+}
+
+
+/*!
+ * \brief SlotAllocator::release
+ * \param slot slot from \fn allocate(), released only once
+ */
+void SlotAllocator::release(size_t slot)
+{
+  freeSlots.push_back(slot);
+  count--;
+}
+
+
+/*!
+ * \brief SlotAllocator::clear
+ *
+ * Release all slots.
+ */
+void SlotAllocator::clear()
+{
+  freeSlots.clear();
+  next = 0;
+  count = 0;
+}
+
+
+/*!
+ * \brief SlotAllocator::trim
+ *
+ * Lower \fn highWater() below released slots at the
+ * top, so storage indexed by slot can shrink. Free
+ * slots are reused lowest first from now on. O(n log n).
+ */
+void SlotAllocator::trim()
+{
+  std::sort(freeSlots.begin(), freeSlots.end());
+  while(!freeSlots.empty() && (freeSlots.back() + 1 == next))
+    {
+      freeSlots.pop_back();
+      next--;
+    }
+  // lowest free slot is taken first
+  std::reverse(freeSlots.begin(), freeSlots.end());
+  std::vector<size_t>(freeSlots).swap(freeSlots);
+}
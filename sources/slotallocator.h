@@ -0,0 +1,49 @@
+#ifndef SLOTALLOCATOR_H
+#define SLOTALLOCATOR_H
+
+#include <vector>
+#include <stddef.h>
+
+
+class SlotAllocator
+{
+
+public:
+  explicit SlotAllocator();
+  ~SlotAllocator();
+
+  size_t allocate();
+  void release(size_t slot);
+  void clear();
+  void trim();
+
+  inline size_t used();
+  inline size_t highWater();
+  inline size_t memoryBytes();
+
+private:
+  std::vector<size_t> freeSlots;    ///< Released slots, reused last in first out
+  size_t next;             ///< Slots below it were allocated at least once
+  size_t count;            ///< Slots allocated now
+};
+
+
+inline size_t SlotAllocator::used()
+{
+  return count;
+}
+
+
+inline size_t SlotAllocator::highWater()
+{
+  return next;
+}
+
+
+inline size_t SlotAllocator::memoryBytes()
+{
+  return freeSlots.capacity() * sizeof(size_t);
+}
+
+
+#endif // SLOTALLOCATOR_H
@@ -0,0 +1,97 @@
+#include "streambuffer.h"
+
+
+/*!
+ * \brief StreamBuffer::StreamBuffer
+ * \param size number of the latest samples to keep
+ *
+ * Memory is allocated once here, buffer never grows
+ * no matter how long the stream runs.
+ */
+StreamBuffer::StreamBuffer(size_t size)
+  : samples(size > 0 ? size : 1), head(0), reserved(0)
+{
+
+}
+
+
+StreamBuffer::~StreamBuffer()
+{
+
+}
+
+
+/*!
+ * \brief StreamBuffer::push
+ * \param x sample position, greater than the last one
+ * \param y sample value
+ *
+ * Called by the only producer thread, never waits.
+ * The oldest sample is overwritten when buffer is full.
+ */
+void StreamBuffer::push(double x, double y)
+{
+  push(&x, &y, 1);
+}
+
+
+/*!
+ * \brief StreamBuffer::push
+ * \param x sample positions
+ * \param y sample values
+ * \param count number of samples
+ *
+ * Same as pushing samples one by one,
+ * but readers see them all at once. Samples
+ * being overwritten are reserved first, the fence
+ * orders that before the writes, see \fn read().
+ */
+void StreamBuffer::push(const double *x, const double *y, size_t count)
+{
+  size_t h = head.load(std::memory_order_relaxed);
+  reserved.store(h + count, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  for(size_t i = 0; i < count; i++)
+    {
+      Sample &s = samples[(h + i) % samples.size()];
+      s.x.store(x[i], std::memory_order_relaxed);
+      s.y.store(y[i], std::memory_order_relaxed);
+    }
+  head.store(h + count, std::memory_order_release);
+}
+
+
+/*!
+ * \brief StreamBuffer::read
+ * \param from index of the first sample to copy
+ * \param to index after the last sample to copy, not greater than \fn written()
+ * \param x where positions are copied
+ * \param y where values are copied
+ * \return index of the first copied sample that is valid
+ *
+ * Consumer side, never blocks the producer. If producer
+ * went round the ring while samples were copied, the oldest
+ * of them could be overwritten in the middle of the copy,
+ * they are not valid and should be skipped. Works as a
+ * seqlock: if a copied value was written by a later push,
+ * the fence pair makes its reservation visible here.
+ */
+size_t StreamBuffer::read(size_t from, size_t to, double *x, double *y)
+{
+  size_t size = samples.size();
+  for(size_t i = from; i < to; i++)
+    {
+      const Sample &s = samples[i % size];
+      x[i - from] = s.x.load(std::memory_order_relaxed);
+      y[i - from] = s.y.load(std::memory_order_relaxed);
+    }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  size_t end = reserved.load(std::memory_order_relaxed);
+
+  // slots up to the reserved end are the ones producer can be writing right now
+  if(end > from + size)
+    from = end - size;
+
+  return (from < to) ? from : to;
+}
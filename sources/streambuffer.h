@@ -0,0 +1,58 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <vector>
+#include <atomic>
+#include <stddef.h>
+
+
+class StreamBuffer
+{
+
+  // relaxed atomics, a copy racing with producer gets old or new
+  // value instead of a data race, \fn read() tells which are valid
+  struct Sample
+  {
+    std::atomic<double> x;
+    std::atomic<double> y;
+  };
+
+public:
+  explicit StreamBuffer(size_t size);
+  ~StreamBuffer();
+
+  void push(double x, double y);
+  void push(const double *x, const double *y, size_t count);
+
+  size_t read(size_t from, size_t to, double *x, double *y);
+
+  inline size_t capacity();
+  inline size_t written();
+
+private:
+  std::vector<Sample> samples;    ///< Ring of the latest samples, never reallocated
+  std::atomic<size_t> head;       ///< Number of samples ever pushed, slot of the next one is head % capacity
+  std::atomic<size_t> reserved;   ///< End of samples producer writes now, equals \var head between pushes
+};
+
+
+inline size_t StreamBuffer::capacity()
+{
+  return samples.size();
+}
+
+
+/*!
+ * \brief StreamBuffer::written
+ * \return number of samples ever pushed
+ *
+ * Samples before \fn written() - \fn capacity()
+ * are already overwritten.
+ */
+inline size_t StreamBuffer::written()
+{
+  return head.load(std::memory_order_acquire);
+}
+
+
+#endif // STREAMBUFFER_H
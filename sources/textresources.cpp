@@ -0,0 +1,142 @@
+#include "textresources.h"
+
+
+std::unordered_map<QOpenGLContextGroup *, std::weak_ptr<TextResources> > TextResources::registry;
+size_t TextResources::atlasBudget = 0;
+size_t TextResources::totalAtlasBytes = 0;
+
+
+TextResources::TextResources(QOpenGLContextGroup *group)
+{
+  shareGroup = group;
+  groupAtlasBytes = 0;
+  ready = false;
+  text_prog = 0;
+  text_matrix = -1;
+  text_pixel = -1;
+  layer_prog = 0;
+  characterWidth = 0;
+  characterHeight = 0;
+  texAtlas.rows = 0;
+  texAtlas.cols = 0;
+  texAtlas.rowFactor = 0;
+  texAtlas.colFactor = 0;
+}
+
+
+/*!
+ * \brief TextResources::~TextResources
+ *
+ * Called when the last \class RenderText of the share
+ * group releases resources. Program and atlas are deleted
+ * if context of the group is current, otherwise they
+ * go away together with the group. Waits for atlases
+ * that are still rasterized.
+ */
+TextResources::~TextResources()
+{
+  std::unordered_map<QOpenGLContextGroup *, std::weak_ptr<TextResources> >::iterator it = registry.find(shareGroup);
+  if((it != registry.end()) && it->second.expired())
+    registry.erase(it);
+
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  if(ready && (context != nullptr) && (context->shareGroup() == shareGroup))
+    {
+      initializeOpenGLFunctions();
+      glDeleteProgram(text_prog);
+      glDeleteProgram(layer_prog);
+      for(std::unordered_map<int, AtlasTexture>::iterator atlas = atlases.begin(); atlas != atlases.end(); atlas++)
+        glDeleteTextures(1, &atlas->second.texture);
+    }
+  totalAtlasBytes -= groupAtlasBytes;
+}
+
+
+/*!
+ * \brief TextResources::acquire
+ * \return resources shared by all contexts of the current share group
+ *
+ * Should be called with current OpenGL context. The first
+ * caller of the group gets resources that are not \var ready
+ * and should compile program and rasterize glyphs, others
+ * get the same ones. Resources live while anyone holds them.
+ * Only GUI thread should call it.
+ */
+std::shared_ptr<TextResources> TextResources::acquire()
+{
+  QOpenGLContext *context = QOpenGLContext::currentContext();
+  QOpenGLContextGroup *group = (context != nullptr) ? context->shareGroup() : nullptr;
+
+  std::shared_ptr<TextResources> shared = registry[group].lock();
+  if(!shared)
+    {
+      shared.reset(new TextResources(group));
+      registry[group] = shared;
+    }
+  return shared;
+}
+
+
+/*!
+ * \brief TextResources::scaleKey
+ * \param scale device pixel ratio
+ * \return key of atlas rasterized for \param scale in \var atlases
+ */
+int TextResources::scaleKey(double scale)
+{
+  return static_cast<int>(scale * ATLAS_SCALE_STEPS + 0.5);
+}
+
+
+/*!
+ * \brief TextResources::setAtlasBudget
+ * \param bytes bytes of atlases of each share group, 0 is unlimited
+ *
+ * Only written here, see \fn RenderText::setAtlasBudget().
+ */
+void TextResources::setAtlasBudget(size_t bytes)
+{
+  atlasBudget = bytes;
+}
+
+
+/*!
+ * \brief TextResources::imageBytes
+ * \param images layers of atlas
+ * \return bytes of texture the layers are loaded to,
+ *    one byte per texel
+ */
+size_t TextResources::imageBytes(const AtlasImages &images)
+{
+  return static_cast<size_t>(images.regular.width()) * images.regular.height() +
+         static_cast<size_t>(images.bold.width()) * images.bold.height();
+}
+
+
+/*!
+ * \brief TextResources::addAtlas
+ * \param key \fn scaleKey() of atlas
+ * \param texture loaded atlas
+ * \param bytes size of \param texture, see \fn imageBytes()
+ * \return atlas, without users
+ */
+std::unordered_map<int, AtlasTexture>::iterator TextResources::addAtlas(int key, GLuint texture, size_t bytes)
+{
+  AtlasTexture atlas = { texture, bytes, 0 };
+  groupAtlasBytes += bytes;
+  totalAtlasBytes += bytes;
+  return atlases.insert(std::pair<int, AtlasTexture>(key, atlas)).first;
+}
+
+
+/*!
+ * \brief TextResources::removeAtlas
+ * \param atlas atlas which texture caller deleted
+ * \return atlas after \param atlas
+ */
+std::unordered_map<int, AtlasTexture>::iterator TextResources::removeAtlas(std::unordered_map<int, AtlasTexture>::iterator atlas)
+{
+  groupAtlasBytes -= atlas->second.bytes;
+  totalAtlasBytes -= atlas->second.bytes;
+  return atlases.erase(atlas);
+}
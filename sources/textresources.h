@@ -0,0 +1,119 @@
+#ifndef TEXTRESOURCES_H
+#define TEXTRESOURCES_H
+
+#include <QOpenGLFunctions_3_3_Core>
+#include <QOpenGLContext>
+#include <QImage>
+#include <QString>
+
+#include <memory>
+#include <unordered_map>
+#include <future>
+
+#include "layouttypes.h"
+
+#define ATLAS_SCALE_STEPS 100    ///< Atlases are cached per device pixel ratio, rounded to 1/100
+
+
+struct TexAtlas   // in work
+{
+  GLint rows;
+  GLint cols;
+  GLdouble rowFactor;
+  GLdouble colFactor;
+};
+
+
+struct AtlasImages
+{
+  QImage regular;         ///< Layer 0 of atlas, glyphs rasterized at device scale
+  QImage bold;            ///< Layer 1
+  GLsizei cellWidth;      ///< Size of glyph cell in texels
+  GLsizei cellHeight;
+};
+
+
+struct AtlasTexture
+{
+  GLuint texture;         ///< Texture array, regular layer and bold one
+  size_t bytes;           ///< Texels of both layers
+  int users;              ///< Renderers that draw with it now, unused ones can be evicted
+};
+
+
+class TextResources : protected QOpenGLFunctions_3_3_Core
+{
+
+public:
+  ~TextResources();
+
+  static std::shared_ptr<TextResources> acquire();
+  static int scaleKey(double scale);
+  static size_t imageBytes(const AtlasImages &images);
+  static void setAtlasBudget(size_t bytes);
+  static inline size_t getAtlasBudget();
+
+  std::unordered_map<int, AtlasTexture>::iterator addAtlas(int key, GLuint texture, size_t bytes);
+  std::unordered_map<int, AtlasTexture>::iterator removeAtlas(std::unordered_map<int, AtlasTexture>::iterator atlas);
+  inline size_t atlasBytes();
+  static inline size_t allAtlasBytes();
+
+  bool ready;             ///< Program is linked and glyphs are rasterized
+
+  std::unordered_map<char, Character> Characters;  ///< Glyph metrics in logical pixels and atlas positions, the same for every scale
+  TexAtlas texAtlas;      ///< Holds information about texture atlas
+  QString atlasChars;     ///< Characters painted to every atlas
+  std::unordered_map<int, AtlasTexture> atlases;   ///< Texture array atlases, by \fn scaleKey(), see \fn addAtlas()
+  std::unordered_map<int, std::future<AtlasImages> > pendingAtlases;   ///< Atlases rasterized on worker threads, not loaded yet
+  GLuint text_prog;       ///< Shader program that used to render characters glyphs
+  GLint text_matrix;      ///< Location of projection matrix uniform, resolved once after link
+  GLint text_pixel;       ///< Location of pixel size uniform, scales offsets of rotated glyphs
+  GLuint layer_prog;      ///< Shader program that puts cached label layers on screen
+  int characterWidth;
+  int characterHeight;
+
+private:
+  explicit TextResources(QOpenGLContextGroup *group);
+
+  QOpenGLContextGroup *shareGroup;    ///< Contexts that can use program and atlas
+  size_t groupAtlasBytes;  ///< Bytes of \var atlases
+
+  static size_t totalAtlasBytes;      ///< Bytes of atlases of all share groups
+  static size_t atlasBudget;          ///< Bytes of atlases of a share group above which unused ones are evicted, 0 keeps all
+
+  static std::unordered_map<QOpenGLContextGroup *, std::weak_ptr<TextResources> > registry;
+};
+
+
+/*!
+ * \brief TextResources::atlasBytes
+ * \return bytes of atlases of the share group
+ */
+inline size_t TextResources::atlasBytes()
+{
+  return groupAtlasBytes;
+}
+
+
+/*!
+ * \brief TextResources::getAtlasBudget
+ * \return bytes of atlases of a share group above which
+ *    unused ones are evicted, 0 keeps all
+ */
+inline size_t TextResources::getAtlasBudget()
+{
+  return atlasBudget;
+}
+
+
+/*!
+ * \brief TextResources::allAtlasBytes
+ * \return bytes of atlases of all share groups
+ */
+inline size_t TextResources::allAtlasBytes()
+{
+  return totalAtlasBytes;
+}
+
+
+#endif // TEXTRESOURCES_H
@@ -0,0 +1,291 @@
+#include "textview.h"
+#include "tracezones.h"
+#include <algorithm>
+#include <math.h>
+
+
+TextView::TextView(QWidget *parent) : PlotWidget(parent)
+{
+  scrollRow = 0;
+  follow = true;
+  laidFirst = 0;
+  laidLast = 0;
+  relayout = true;
+  lineHeight = 1;
+  wgtWidth = 0;
+  wgtHeight = 0;
+}
+
+
+TextView::~TextView()
+{
+
+}
+
+
+/*!
+ * \brief TextView::appendLine
+ * \param line text without line break
+ *
+ * Only stored here, line is laid out when it's
+ * scrolled to. Repaints of many appends between
+ * frames are merged.
+ */
+void TextView::appendLine(const std::string &line)
+{
+  lines.append(line);
+  update();
+}
+
+
+/*!
+ * \brief TextView::appendText
+ * \param text lines separated by '\n'
+ * \param length number of characters
+ * \return number of lines appended
+ */
+size_t TextView::appendText(const char *text, size_t length)
+{
+  size_t added = lines.appendText(text, length);
+  update();
+  return added;
+}
+
+
+/*!
+ * \brief TextView::clear
+ *
+ * Remove all lines.
+ */
+void TextView::clear()
+{
+  lines.clear();
+  scrollRow = 0;
+  relayout = true;
+  update();
+}
+
+
+/*!
+ * \brief TextView::scrollTo
+ * \param row row to put at the top edge, fraction scrolls part of row
+ *
+ * Scrolling to the end keeps view following
+ * appended lines, scrolling up stops it.
+ */
+void TextView::scrollTo(double row)
+{
+  double last = lastScroll();
+  scrollRow = std::max(0.0, std::min(row, last));
+  follow = (scrollRow >= last);
+  update();
+}
+
+
+/*!
+ * \brief TextView::scrollBy
+ * \param rows rows to scroll down, negative to scroll up
+ */
+void TextView::scrollBy(double rows)
+{
+  scrollTo(scrollRow + rows);
+}
+
+
+/*!
+ * \brief TextView::setFollow
+ * \param enabled keep the newest line in view
+ */
+void TextView::setFollow(bool enabled)
+{
+  follow = enabled;
+  update();
+}
+
+
+/*!
+ * \brief TextView::visibleRows
+ * \return rows that fit to widget, with partly visible ones at both edges
+ */
+size_t TextView::visibleRows()
+{
+  return wgtHeight / lineHeight + 2;
+}
+
+
+/*!
+ * \brief TextView::lastScroll
+ * \return \var scrollRow that puts the last line at the bottom edge
+ */
+double TextView::lastScroll()
+{
+  return std::max(0.0, lines.lines() - wgtHeight / static_cast<double>(lineHeight));
+}
+
+
+/*!
+ * \brief TextView::initializeGL
+ *
+ * Glyph metrics of the atlas are given to \var layout,
+ * rows are laid out in pixels, see \fn Plot::initializeGL().
+ */
+void TextView::initializeGL()
+{
+  initWidget();
+
+  glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+  rendertext.setDevicePixelRatio(devicePixelRatioF());
+  rendertext.initTextRender(&glstate, [this]() { QMetaObject::invokeMethod(this, "update", Qt::QueuedConnection); });
+  rendertext.setupLayout(layout);
+  lineHeight = rendertext.getCharacterHeight() + TEXT_VIEW_SPACING;
+
+  Proj pixels;
+  pixels.left = 0;
+  pixels.right = 1;
+  pixels.bottom = 0;
+  pixels.top = 1;
+  layout.setView(pixels, 1, 1);
+  relayout = true;
+}
+
+
+/*!
+ * \brief TextView::resizeGL
+ * \param width passed by Qt, in logical pixels
+ * \param height passed by Qt
+ */
+void TextView::resizeGL(int width, int height)
+{
+  glstate.invalidate();
+
+  wgtWidth = width;
+  wgtHeight = height;
+  rendertext.setDevicePixelRatio(devicePixelRatioF());
+  layout.setDeviceScale(devicePixelRatioF());
+  relayout = true;
+}
+
+
+/*!
+ * \brief TextView::layoutRows
+ * \param from the first row to lay out
+ * \param to row after the last one
+ *
+ * Rows are placed from the top of \param from down,
+ * so coordinates stay small no matter how many lines
+ * are above and float vertices keep whole pixels.
+ * Cost depends only on number of rows.
+ */
+void TextView::layoutRows(size_t from, size_t to)
+{
+  vertices.clear();
+  laidFirst = from;
+  laidLast = from;
+  appendRows(to);
+}
+
+
+/*!
+ * \brief TextView::appendRows
+ * \param to row after the last one to lay out
+ *
+ * Rows from \var laidLast on are placed after the
+ * laid out ones, which stay as they are, lines
+ * never change once appended.
+ */
+void TextView::appendRows(size_t to)
+{
+  TRACE_ZONE("layout rows");
+  size_t placed = vertices.size() / 6;
+  size_t glyphs = placed;
+  for(size_t row = laidLast; row < to; row++)
+    {
+      size_t length = 0;
+      lines.line(row, &length);
+      glyphs += std::min<size_t>(length, TEXT_VIEW_COLUMNS);
+    }
+  vertices.resize(glyphs * 6);
+
+  std::string text;
+  for(size_t row = laidLast; (row < to) && (placed < glyphs); row++)
+    {
+      size_t length = 0;
+      const char *chars = lines.line(row, &length);
+      text.assign(chars, std::min<size_t>(length, TEXT_VIEW_COLUMNS));
+      double bottom = -static_cast<double>((row - laidFirst + 1) * lineHeight);
+      placed += layout.placeString(text, TEXT_VIEW_INDENT, bottom, defaultTextStyle,
+                                   vertices.data() + placed * 6, glyphs - placed);
+    }
+  vertices.resize(placed * 6);
+
+  laidLast = to;
+}
+
+
+/*!
+ * \brief TextView::paintGL
+ *
+ * Rows are laid out again only when visible ones leave
+ * laid out range, or after resize. Otherwise scroll only
+ * changes projection matrix and rows already loaded are
+ * drawn in one call. When only appended rows came into
+ * view, e.g. view follows them, just those are laid out
+ * and loaded.
+ */
+void TextView::paintGL()
+{
+  TRACE_ZONE("paintGL text view");
+  beginFrame();
+  GPU_ZONE(gpuZones, "frame");
+
+  if(follow)
+    scrollRow = lastScroll();
+
+  size_t first = static_cast<size_t>(scrollRow);
+  size_t last = std::min(lines.lines(), first + visibleRows());
+  bool changed = false;
+  size_t loaded = 0;
+  if(!relayout && (first >= laidFirst) && (last > laidLast) && (first - laidFirst <= 2 * TEXT_VIEW_MARGIN))
+    {
+      loaded = vertices.size();
+      appendRows(std::min(lines.lines(), last + TEXT_VIEW_MARGIN));
+      changed = true;
+    }
+  else if(relayout || (first < laidFirst) || (last > laidLast))
+    {
+      size_t from = (first > TEXT_VIEW_MARGIN) ? first - TEXT_VIEW_MARGIN : 0;
+      size_t to = std::min(lines.lines(), last + TEXT_VIEW_MARGIN);
+      layoutRows(from, to);
+      relayout = false;
+      changed = true;
+    }
+
+  // top edge of widget in pixels from the top of the first laid out row,
+  // whole pixels keep glyphs sharp
+  Proj view;
+  view.left = 0;
+  view.right = wgtWidth;
+  view.top = -floor((scrollRow - laidFirst) * lineHeight + 0.5);
+  view.bottom = view.top - wgtHeight;
+  rendertext.setProjMatrix(view);
+  rendertext.updateShaderMatrix();
+
+  glClear(GL_COLOR_BUFFER_BIT);
+  {
+    GPU_ZONE(gpuZones, "rows");
+    rendertext.renderBatch(vertices, changed, loaded);
+  }
+}
+
+
+/*!
+ * \brief TextView::wheelEvent
+ * \param event three rows per wheel step
+ */
+void TextView::wheelEvent(QWheelEvent *event)
+{
+  scrollBy(-event->angleDelta().y() / 40.0);
+}
+
+
@@ -0,0 +1,83 @@
+#ifndef TEXTVIEW_H
+#define TEXTVIEW_H
+
+#include <QWheelEvent>
+
+#include <vector>
+#include <string>
+
+#include "plotwidget.h"
+#include "textlayout.h"
+#include "linebuffer.h"
+
+#define TEXT_VIEW_MARGIN 64       ///< Rows laid out above and below visible ones, scrolled over without layout
+#define TEXT_VIEW_COLUMNS 256     ///< Most glyphs laid out per row, the rest is past the right edge
+#define TEXT_VIEW_SPACING 2       ///< Pixels between rows
+#define TEXT_VIEW_INDENT 4        ///< Pixels left of text
+
+
+/*!
+ * \brief The TextView class
+ *
+ * Scrolling view of text lines, e.g. log or events pane
+ * next to plots, drawn from the glyph atlas of labels.
+ * Only visible rows and TEXT_VIEW_MARGIN rows around them
+ * are laid out and loaded. Scrolling inside laid out rows
+ * only moves projection matrix, so it's one draw with no
+ * upload, and appended lines cost nothing until they are
+ * scrolled to. Following view lays out and loads only
+ * appended rows, until 2 * TEXT_VIEW_MARGIN rows scrolled
+ * out above, then all rows are laid out again.
+ */
+class TextView : public PlotWidget
+{
+  Q_OBJECT
+
+public:
+  explicit TextView(QWidget *parent = nullptr);
+  ~TextView();
+
+  void appendLine(const std::string &line);
+  size_t appendText(const char *text, size_t length);
+  void clear();
+  inline size_t lineCount();
+
+  void scrollTo(double row);
+  void scrollBy(double rows);
+  void setFollow(bool enabled);
+
+protected:
+  void initializeGL() override;
+  void resizeGL(int width, int height) override;
+  void paintGL() override;
+  void wheelEvent(QWheelEvent *event) override;
+
+private:
+  void layoutRows(size_t from, size_t to);
+  void appendRows(size_t to);
+  size_t visibleRows();
+  double lastScroll();
+
+  TextLayout layout;      ///< Lays out rows on GUI thread, in pixels
+  LineBuffer lines;
+  std::vector<GlyphVertex> vertices;   ///< Rows from \var laidFirst to \var laidLast, in pixels from the top of \var laidFirst
+
+  double scrollRow;       ///< Row at the top edge of widget, fraction is part of row scrolled out
+  bool follow;            ///< Keep the newest line in view as lines are appended
+  size_t laidFirst;       ///< Rows in \var vertices
+  size_t laidLast;
+  bool relayout;          ///< Rows should be laid out again, e.g. after resize
+  int lineHeight;         ///< Pixels of row, with spacing
+
+  int wgtWidth;
+  int wgtHeight;
+};
+
+
+inline size_t TextView::lineCount()
+{
+  return lines.lines();
+}
+
+
+#endif // TEXTVIEW_H